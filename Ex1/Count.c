@@ -3,10 +3,10 @@
  * @author  Vitaly Frolov vitaly.frolov@mail.huji.ac.il
  * @version 1.0
  * @date 1 Nov 2015
- * 
+ *
  * @brief System to track amount of characters used in a input.
  *
- 
+
  * @section DESCRIPTION
  * The system track amount of characters used in a input.
  * Input  : Input by the user.
@@ -15,68 +15,1258 @@
  */
 
  // ------------------------------ includes -----------------------------
+// needed for madvise and posix_memalign under -std=c99
+#define _DEFAULT_SOURCE
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include <time.h>
+#include <zlib.h>
+#include "Counter.h"
 
 // -------------------------- const definitions -------------------------
-/** 
+/**
  * @def NL 10
  * @brief A macro that sets the new line ASCII code.
  */
 #define NL 10
-/** 
- * @def SPACE 32
- * @brief A macro that sets the space key ASCII code.
- */
-#define SPACE 32
-/** 
+/**
  * @def TRUE 1
  * @brief A macro that sets true value to be 1.
  */
 #define TRUE 1
-/** 
+/**
  * @def TRUE 1
  * @brief A macro that sets false value to be 0.
  */
 #define FALSE 0
+/**
+ * @def READ_BUFFER_SIZE 1048576
+ * @brief A macro that sets the size of the buffer pipes and terminals are read into.
+ */
+#define READ_BUFFER_SIZE 1048576
+/**
+ * @def READ_BUFFER_ALIGNMENT 4096
+ * @brief A macro that sets the alignment of the read buffer, a page.
+ */
+#define READ_BUFFER_ALIGNMENT 4096
+/**
+ * @def STDIN_FD 0
+ * @brief A macro that sets the file descriptor of the standard input.
+ */
+#define STDIN_FD 0
+/**
+ * @def THREADS_FLAG "-j"
+ * @brief A macro that sets the flag that is followed by the amount of counting threads.
+ */
+#define THREADS_FLAG "-j"
+/**
+ * @def LIST_FLAG "-l"
+ * @brief A macro that sets the flag that reads the files to count from the standard input,
+ * one path per line.
+ */
+#define LIST_FLAG "-l"
+/**
+ * @def SEPARATORS_FLAG "-d"
+ * @brief A macro that sets the flag that is followed by the bytes that separate words,
+ * escapes as \\t and \\x09 are allowed. new line always separates words.
+ */
+#define SEPARATORS_FLAG "-d"
+/**
+ * @def METRICS_FLAG "-m"
+ * @brief A macro that sets the flag that adds the byte histogram, the longest line and the
+ * average word length to the counts.
+ */
+#define METRICS_FLAG "-m"
+/**
+ * @def UTF8_FLAG "-u"
+ * @brief A macro that sets the flag that counts the input as utf-8, code points are the
+ * characters and every unicode white space separates words.
+ */
+#define UTF8_FLAG "-u"
+/**
+ * @def STATE_FLAG "-s"
+ * @brief A macro that sets the flag that is followed by the state file of a resumable count.
+ */
+#define STATE_FLAG "-s"
+/**
+ * @def FOLLOW_FLAG "-f"
+ * @brief A macro that sets the flag that keeps counting what is appended to the file.
+ */
+#define FOLLOW_FLAG "-f"
+/**
+ * @def STATE_TEMP_SUFFIX ".tmp"
+ * @brief A macro that sets the suffix of the file a state is written to before it replaces
+ * the previous one.
+ */
+#define STATE_TEMP_SUFFIX ".tmp"
+/**
+ * @def FOLLOW_POLL_SECONDS 1
+ * @brief A macro that sets how often a followed file is checked when it can't be watched.
+ */
+#define FOLLOW_POLL_SECONDS 1
+/**
+ * @def FNV_OFFSET 14695981039346656037
+ * @brief A macro that sets the initial value of the FNV-1a hash of the separators.
+ */
+#define FNV_OFFSET 14695981039346656037ULL
+/**
+ * @def FNV_PRIME 1099511628211
+ * @brief A macro that sets the multiplier of the FNV-1a hash of the separators.
+ */
+#define FNV_PRIME 1099511628211ULL
+/**
+ * @def TOP_FLAG "--top"
+ * @brief A macro that sets the flag that is followed by the amount of most frequent words to
+ * print.
+ */
+#define TOP_FLAG "--top"
+/**
+ * @def MAX_TOP 1000000
+ * @brief A macro that sets the most words --top may print.
+ */
+#define MAX_TOP 1000000
+/**
+ * @def GZIP_FLAG "-z"
+ * @brief A macro that sets the flag that decompresses the input as gzip before it's counted.
+ */
+#define GZIP_FLAG "-z"
+/**
+ * @def GZIP_WINDOW_BITS 47
+ * @brief A macro that sets the window bits that make zlib inflate a gzip or zlib stream with
+ * the largest window.
+ */
+#define GZIP_WINDOW_BITS (MAX_WBITS + 32)
+/**
+ * @def RING_SLOTS 4
+ * @brief A macro that sets the amount of buffers between the decompressing and the counting
+ * threads.
+ */
+#define RING_SLOTS 4
+/**
+ * @def BYTES_IN_MB 1000000.0
+ * @brief A macro that sets the amount of bytes in the megabytes the throughput is given in.
+ */
+#define BYTES_IN_MB 1000000.0
+
+/**
+ * @struct GzipTotals
+ * @brief The amount of bytes read and decompressed from gzip inputs.
+ */
+typedef struct GzipTotals
+{
+    uint64_t compressed;
+    uint64_t uncompressed;
+} GzipTotals;
+
+/**
+ * @struct FileJob
+ * @brief One file of a multi file count.
+ */
+typedef struct FileJob
+{
+    const char *fileName;
+    Counter counter;
+    GzipTotals gzip;
+    int counted;
+} FileJob;
+
+/**
+ * @struct FilePool
+ * @brief The files of a multi file count, handed out one at a time to a bounded amount of
+ * worker threads.
+ */
+typedef struct FilePool
+{
+    FileJob *jobs;
+    size_t numOfJobs;
+    // the index of the next job that wasn't taken by a worker yet
+    size_t nextJob;
+    pthread_mutex_t lock;
+    const CounterOptions *options;
+    // whether the files are gzip
+    int gzip;
+} FilePool;
+
+/**
+ * @struct Checkpoint
+ * @brief The state of the count of a file that is only appended to, enough to go on counting
+ * from where the previous count stopped.
+ */
+typedef struct Checkpoint
+{
+    // identify the file, so a rotated or truncated file is counted from its beginning
+    uint64_t device;
+    uint64_t inode;
+    uint64_t offset;
+    Counter counter;
+    // the mode the file was counted in, and a hash of the separators it was counted with
+    int utf8;
+    uint64_t separators;
+} Checkpoint;
+
+/**
+ * @struct Ring
+ * @brief The buffers a decompressing thread fills and the counting thread counts, each slot
+ * is reused once it was counted.
+ */
+typedef struct Ring
+{
+    int fd;
+    unsigned char *buffers[RING_SLOTS];
+    size_t lengths[RING_SLOTS];
+    // the filled slots that weren't counted yet are filled slots from first on
+    size_t first;
+    size_t filled;
+    // TRUE once nothing more will be filled, failed tells if the input wasn't whole gzip
+    int ended;
+    int failed;
+    GzipTotals totals;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+} Ring;
 
 // ------------------------------ functions -----------------------------
+/**
+ * @brief Parses the separators given after SEPARATORS_FLAG, the escapes \t \n \r \v \f \\
+ * and \xHH are allowed.
+ * @param arg the argument
+ * @param isSeparator will be set TRUE for every byte in the argument
+ * @return TRUE if the argument is valid
+ */
+static int parseSeparators(const char *arg, unsigned char *isSeparator)
+{
+    memset(isSeparator, FALSE, NUM_OF_BYTES);
+    const char *escapes = "t\tn\nr\rv\vf\f\\\\";
+    while(*arg != '\0')
+    {
+        unsigned char c = (unsigned char)*arg++;
+        if(c == '\\')
+        {
+            const char *escape = *arg == '\0' ? NULL : strchr(escapes, *arg);
+            if(*arg == 'x' && isxdigit((unsigned char)arg[1]) && isxdigit((unsigned char)arg[2]))
+            {
+                char hex[3] = {arg[1], arg[2], '\0'};
+                c = (unsigned char)strtol(hex, NULL, 16);
+                arg += 3;
+            }
+            else if(escape != NULL && (escape - escapes) % 2 == 0)
+            {
+                c = (unsigned char)escape[1];
+                arg++;
+            }
+            else
+            {
+                return FALSE;
+            }
+        }
+        isSeparator[c] = TRUE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Counts a range of a regular file by mapping it into memory, so the kernel reads the
+ * page cache directly without any copy or syscall per block.
+ * @param fd the file descriptor of the file
+ * @param offset the offset in the file the range starts at
+ * @param size the size of the range in bytes
+ * @param threads the maximal amount of counting threads
+ * @param counter the counter
+ * @return TRUE if the range was counted, FALSE if it couldn't be mapped
+ */
+static int countMapped(int fd, uint64_t offset, size_t size, int threads, Counter *counter)
+{
+    // mmap only takes offsets that are a multiple of the page size
+    size_t skip = (size_t)(offset % (uint64_t)sysconf(_SC_PAGESIZE));
+    if(size > SIZE_MAX - skip)
+    {
+        return FALSE;
+    }
+    unsigned char *data = mmap(NULL, skip + size, PROT_READ, MAP_PRIVATE, fd,
+                               (off_t)(offset - skip));
+    if(data == MAP_FAILED)
+    {
+        return FALSE;
+    }
+    // the kernel walks the file once from start to end, so the read ahead can be aggressive
+    madvise(data, skip + size, MADV_SEQUENTIAL);
+    feedCounterParallel(counter, data + skip, size, threads);
+    munmap(data, skip + size);
+    return TRUE;
+}
+
+/**
+ * @brief Counts a pipe, terminal or any file that couldn't be mapped with large reads into
+ * one page aligned buffer.
+ * @param fd the file descriptor of the input
+ * @param counter the counter
+ * @return TRUE if the input was counted until its end, FALSE on a read error
+ */
+static int countStream(int fd, Counter *counter)
+{
+    void *buffer;
+    if(posix_memalign(&buffer, READ_BUFFER_ALIGNMENT, READ_BUFFER_SIZE) != 0)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return FALSE;
+    }
+    ssize_t length;
+    while((length = read(fd, buffer, READ_BUFFER_SIZE)) != 0)
+    {
+        if(length < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(length < 0)
+        {
+            free(buffer);
+            return FALSE;
+        }
+        feedCounter(counter, buffer, (size_t)length);
+    }
+    free(buffer);
+    return TRUE;
+}
+
+/**
+ * @brief Reads the input of the ring and inflates it into the free slots, the start routine
+ * of the decompressing thread.
+ * @param arg pointer to the Ring
+ * @return NULL
+ */
+static void *decompress(void *arg)
+{
+    Ring *ring = arg;
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    unsigned char *input = malloc(READ_BUFFER_SIZE);
+    int ok = input != NULL && inflateInit2(&stream, GZIP_WINDOW_BITS) == Z_OK;
+    int status = Z_OK;
+    int ended = !ok;
+    while(!ended)
+    {
+        pthread_mutex_lock(&ring->lock);
+        while(ring->filled == RING_SLOTS)
+        {
+            pthread_cond_wait(&ring->notFull, &ring->lock);
+        }
+        size_t slot = (ring->first + ring->filled) % RING_SLOTS;
+        pthread_mutex_unlock(&ring->lock);
+
+        stream.next_out = ring->buffers[slot];
+        stream.avail_out = READ_BUFFER_SIZE;
+        while(stream.avail_out > 0)
+        {
+            if(stream.avail_in == 0)
+            {
+                ssize_t length = read(ring->fd, input, READ_BUFFER_SIZE);
+                if(length < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if(length <= 0)
+                {
+                    // the input may only end after a whole gzip member
+                    ok = length == 0 && status == Z_STREAM_END;
+                    ended = TRUE;
+                    break;
+                }
+                stream.next_in = input;
+                stream.avail_in = (uInt)length;
+                ring->totals.compressed += (uint64_t)length;
+            }
+            // concatenated gzip members are counted as one input, as gzip -d does
+            if(status == Z_STREAM_END)
+            {
+                inflateReset(&stream);
+            }
+            status = inflate(&stream, Z_NO_FLUSH);
+            if(status != Z_OK && status != Z_STREAM_END)
+            {
+                ok = FALSE;
+                ended = TRUE;
+                break;
+            }
+        }
+
+        pthread_mutex_lock(&ring->lock);
+        ring->lengths[slot] = READ_BUFFER_SIZE - stream.avail_out;
+        ring->totals.uncompressed += ring->lengths[slot];
+        ring->filled++;
+        pthread_cond_signal(&ring->notEmpty);
+        pthread_mutex_unlock(&ring->lock);
+    }
+    pthread_mutex_lock(&ring->lock);
+    ring->ended = TRUE;
+    ring->failed = !ok;
+    pthread_cond_signal(&ring->notEmpty);
+    pthread_mutex_unlock(&ring->lock);
+    if(input != NULL)
+    {
+        inflateEnd(&stream);
+    }
+    free(input);
+    return NULL;
+}
+
+/**
+ * @brief Counts a gzip input, one thread decompresses it into a ring of buffers while the
+ * calling thread counts the buffers filled before, so the two overlap.
+ * @param fd the file descriptor of the compressed input
+ * @param counter the counter
+ * @param totals the bytes read and decompressed are added to it
+ * @return TRUE if the input was counted, FALSE if it isn't whole gzip or couldn't be read
+ */
+static int countCompressed(int fd, Counter *counter, GzipTotals *totals)
+{
+    Ring ring;
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = fd;
+    int allocated = TRUE;
+    for (int i = 0; i < RING_SLOTS; i++)
+    {
+        void *buffer = NULL;
+        allocated = posix_memalign(&buffer, READ_BUFFER_ALIGNMENT, READ_BUFFER_SIZE) == 0 &&
+                    allocated;
+        ring.buffers[i] = buffer;
+    }
+    pthread_t thread;
+    pthread_mutex_init(&ring.lock, NULL);
+    pthread_cond_init(&ring.notEmpty, NULL);
+    pthread_cond_init(&ring.notFull, NULL);
+    int started = allocated && pthread_create(&thread, NULL, decompress, &ring) == 0;
+    while(started)
+    {
+        pthread_mutex_lock(&ring.lock);
+        while(ring.filled == 0 && !ring.ended)
+        {
+            pthread_cond_wait(&ring.notEmpty, &ring.lock);
+        }
+        if(ring.filled == 0)
+        {
+            pthread_mutex_unlock(&ring.lock);
+            break;
+        }
+        size_t slot = ring.first;
+        pthread_mutex_unlock(&ring.lock);
+
+        feedCounter(counter, ring.buffers[slot], ring.lengths[slot]);
+
+        pthread_mutex_lock(&ring.lock);
+        ring.first = (ring.first + 1) % RING_SLOTS;
+        ring.filled--;
+        pthread_cond_signal(&ring.notFull);
+        pthread_mutex_unlock(&ring.lock);
+    }
+    if(started)
+    {
+        pthread_join(thread, NULL);
+        totals->compressed += ring.totals.compressed;
+        totals->uncompressed += ring.totals.uncompressed;
+    }
+    pthread_cond_destroy(&ring.notFull);
+    pthread_cond_destroy(&ring.notEmpty);
+    pthread_mutex_destroy(&ring.lock);
+    for (int i = 0; i < RING_SLOTS; i++)
+    {
+        free(ring.buffers[i]);
+    }
+    if(!allocated)
+    {
+        fprintf(stderr, "Out of memory\n");
+    }
+    return started && !ring.failed;
+}
+
+/**
+ * @brief Counts the whole input behind the file descriptor. only mapped files are split
+ * between threads, a stream is counted by the calling thread.
+ * @param fd the file descriptor of the input
+ * @param threads the maximal amount of counting threads
+ * @param counter the counter
+ * @param gzip NULL for an input that isn't compressed, otherwise the input is gzip and the
+ *        bytes read and decompressed are added to it
+ * @return TRUE if the input was counted, FALSE on a read error
+ */
+static int countFd(int fd, int threads, Counter *counter, GzipTotals *gzip)
+{
+    if(gzip != NULL)
+    {
+        return countCompressed(fd, counter, gzip);
+    }
+    struct stat info;
+    if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0 &&
+       (uint64_t)info.st_size <= SIZE_MAX)
+    {
+        if(countMapped(fd, 0, (size_t)info.st_size, threads, counter))
+        {
+            return TRUE;
+        }
+    }
+    return countStream(fd, counter);
+}
+
+/**
+ * @brief Opens the file and counts it.
+ * @param fileName the path of the file
+ * @param threads the maximal amount of counting threads
+ * @param counter the counter
+ * @param gzip NULL for a file that isn't compressed, otherwise the totals of the gzip inputs
+ * @return TRUE if the file was counted, FALSE if it couldn't be opened or read
+ */
+static int countFile(const char *fileName, int threads, Counter *counter, GzipTotals *gzip)
+{
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0)
+    {
+        fprintf(stderr, "Can not open file: %s\n", fileName);
+        return FALSE;
+    }
+    int counted = countFd(fd, threads, counter, gzip);
+    close(fd);
+    if(!counted)
+    {
+        fprintf(stderr, "Can not read file: %s\n", fileName);
+    }
+    return counted;
+}
+
+/**
+ * @brief Prints the counts, followed by the metrics when they were gathered.
+ * @param counts the counts of the whole input
+ * @param metrics whether the metrics were gathered
+ * @param name printed after the counts, NULL for none
+ */
+static void printCounts(const Counts *counts, int metrics, const char *name)
+{
+    printf("Num of Rows:%" PRIu64 " words:%" PRIu64 " characters:%" PRIu64 "%s%s\n",
+           counts->rows, counts->words, counts->characters, name != NULL ? " " : "",
+           name != NULL ? name : "");
+    if(!metrics)
+    {
+        return;
+    }
+    const Metrics *gathered = &counts->metrics;
+    printf("Longest line:%" PRIu64 " average word length:%.2f\nBytes:", longestLine(gathered),
+           counts->words > 0 ? (double)gathered->wordBytes / (double)counts->words : 0.0);
+    for (int c = 0; c < NUM_OF_BYTES; c++)
+    {
+        if(gathered->histogram[c] > 0)
+        {
+            printf(" %02x:%" PRIu64, c, gathered->histogram[c]);
+        }
+    }
+    printf("\n");
+}
+
+/**
+ * @brief The time of a monotonic clock, for measuring how long a count took.
+ * @return the time in seconds
+ */
+static double secondsNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Prints how many bytes were read and decompressed from gzip inputs, and how fast.
+ * @param totals the bytes read and decompressed
+ * @param seconds how long the count took
+ */
+static void printThroughput(const GzipTotals *totals, double seconds)
+{
+    if(seconds <= 0)
+    {
+        seconds = 1e-9;
+    }
+    printf("Compressed:%" PRIu64 " bytes %.1f MB/s uncompressed:%" PRIu64 " bytes %.1f MB/s\n",
+           totals->compressed, (double)totals->compressed / BYTES_IN_MB / seconds,
+           totals->uncompressed, (double)totals->uncompressed / BYTES_IN_MB / seconds);
+}
+
+/**
+ * @brief Prints the top most frequent words, each after its frequency.
+ * @param counter the counter, which kept the word frequencies
+ * @param top the amount of words to print
+ * @return TRUE if the words were printed, FALSE if the memory ran out
+ */
+static int printTopWords(const Counter *counter, size_t top)
+{
+    const WordEntry **words = malloc(sizeof(WordEntry *) * top);
+    if(words == NULL)
+    {
+        return FALSE;
+    }
+    size_t numOfWords = selectTopWords(counter, top, words);
+    for (size_t i = 0; i < numOfWords; i++)
+    {
+        printf("%" PRIu64 " ", words[i]->count);
+        fwrite(words[i]->word, 1, words[i]->length, stdout);
+        printf("\n");
+    }
+    free(words);
+    return TRUE;
+}
+
+/**
+ * @brief Takes files from the pool and counts them until none are left, the start routine
+ * of the pool's workers.
+ * @param arg pointer to the FilePool
+ * @return NULL
+ */
+static void *fileWorker(void *arg)
+{
+    FilePool *pool = arg;
+    while(TRUE)
+    {
+        pthread_mutex_lock(&pool->lock);
+        size_t i = pool->nextJob++;
+        pthread_mutex_unlock(&pool->lock);
+        if(i >= pool->numOfJobs)
+        {
+            return NULL;
+        }
+        FileJob *job = &pool->jobs[i];
+        job->gzip = (GzipTotals){0, 0};
+        // the files themselves are the unit of parallelism, each is counted serially
+        job->counted = initCounter(&job->counter, pool->options) &&
+                       countFile(job->fileName, 1, &job->counter,
+                                 pool->gzip ? &job->gzip : NULL) &&
+                       finishCounter(&job->counter);
+        if(job->counted && job->counter.counts.invalid)
+        {
+            fprintf(stderr, "Warning: file %s isn't valid utf-8\n", job->fileName);
+        }
+    }
+}
+
+/**
+ * @brief Counts many files on a pool of worker threads, then prints a line for every file
+ * in the given order and a line of the grand total.
+ * @param fileNames the paths of the files
+ * @param numOfFiles the amount of files
+ * @param workers the amount of worker threads
+ * @param options how the files are counted
+ * @param gzip whether the files are gzip, the throughput of all of them is printed after
+ *        the total
+ * @return TRUE if all the files were counted
+ */
+static int countFiles(char **fileNames, size_t numOfFiles, int workers,
+                      const CounterOptions *options, int gzip)
+{
+    double start = secondsNow();
+    FilePool pool;
+    pool.jobs = malloc(sizeof(FileJob) * (numOfFiles > 0 ? numOfFiles : 1));
+    if(pool.jobs == NULL)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return FALSE;
+    }
+    for (size_t i = 0; i < numOfFiles; i++)
+    {
+        pool.jobs[i].fileName = fileNames[i];
+    }
+    pool.numOfJobs = numOfFiles;
+    pool.nextJob = 0;
+    pool.options = options;
+    pool.gzip = gzip;
+    pthread_mutex_init(&pool.lock, NULL);
+    if((size_t)workers > numOfFiles)
+    {
+        workers = numOfFiles > 0 ? (int)numOfFiles : 1;
+    }
+    pthread_t threads[MAX_THREADS];
+    int started = 0;
+    // the calling thread is one of the workers
+    while(started < workers - 1 &&
+          pthread_create(&threads[started], NULL, fileWorker, &pool) == 0)
+    {
+        started++;
+    }
+    fileWorker(&pool);
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool.lock);
+
+    Counts total = {.rows = 0};
+    GzipTotals totalGzip = {0, 0};
+    int allCounted = TRUE;
+    for (size_t i = 0; i < numOfFiles; i++)
+    {
+        FileJob *job = &pool.jobs[i];
+        if(!job->counted)
+        {
+            allCounted = FALSE;
+            continue;
+        }
+        const Counts *counts = &job->counter.counts;
+        printCounts(counts, options->metrics, job->fileName);
+        totalGzip.compressed += job->gzip.compressed;
+        totalGzip.uncompressed += job->gzip.uncompressed;
+        total.rows += counts->rows;
+        total.words += counts->words;
+        total.characters += counts->characters;
+        const Metrics *metrics = &counts->metrics;
+        for (int c = 0; c < NUM_OF_BYTES; c++)
+        {
+            total.metrics.histogram[c] += metrics->histogram[c];
+        }
+        total.metrics.wordBytes += metrics->wordBytes;
+        if(longestLine(metrics) > total.metrics.longestLine)
+        {
+            total.metrics.longestLine = longestLine(metrics);
+        }
+    }
+    printCounts(&total, options->metrics, "total");
+    if(gzip)
+    {
+        printThroughput(&totalGzip, secondsNow() - start);
+    }
+    for (size_t i = 0; i < numOfFiles; i++)
+    {
+        freeCounter(&pool.jobs[i].counter);
+    }
+    free(pool.jobs);
+    return allCounted;
+}
+
+/**
+ * @brief Reads the paths of the files to count from the standard input, one per line.
+ * @param numOfFiles will be set to the amount of paths read
+ * @return array of the paths, NULL if the memory ran out. the array and every path in it
+ *         should be freed
+ */
+static char **readFileList(size_t *numOfFiles)
+{
+    size_t capacity = 16;
+    char **fileNames = malloc(sizeof(char *) * capacity);
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    ssize_t length;
+    *numOfFiles = 0;
+    while(fileNames != NULL && (length = getline(&line, &lineCapacity, stdin)) != -1)
+    {
+        if(length > 0 && line[length - 1] == NL)
+        {
+            line[--length] = '\0';
+        }
+        if(length == 0)
+        {
+            continue;
+        }
+        if(*numOfFiles == capacity)
+        {
+            capacity *= 2;
+            char **larger = realloc(fileNames, sizeof(char *) * capacity);
+            if(larger == NULL)
+            {
+                break;
+            }
+            fileNames = larger;
+        }
+        fileNames[*numOfFiles] = malloc((size_t)length + 1);
+        if(fileNames[*numOfFiles] == NULL)
+        {
+            break;
+        }
+        memcpy(fileNames[(*numOfFiles)++], line, (size_t)length + 1);
+    }
+    free(line);
+    if(fileNames != NULL && !feof(stdin))
+    {
+        for (size_t i = 0; i < *numOfFiles; i++)
+        {
+            free(fileNames[i]);
+        }
+        free(fileNames);
+        fileNames = NULL;
+    }
+    if(fileNames == NULL)
+    {
+        fprintf(stderr, "Out of memory\n");
+    }
+    return fileNames;
+}
+
+/**
+ * @brief Hashes the bytes that separate words in the mode, so a state counted with other
+ * separators is told apart.
+ * @param mode the mode
+ * @return the FNV-1a hash of the separator bitmaps
+ */
+static uint64_t hashSeparators(const CountMode *mode)
+{
+    uint64_t hash = FNV_OFFSET;
+    for (size_t i = 0; i < sizeof(mode->lowBitmap); i++)
+    {
+        hash = (hash ^ mode->lowBitmap[i]) * FNV_PRIME;
+        hash = (hash ^ mode->highBitmap[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * @brief Reads the checkpoint saved by a previous count. a broken state file is ignored, and
+ * the checkpoint is left at the beginning of the file.
+ * @param stateName the path of the state file
+ * @param checkpoint will be set to the saved checkpoint
+ * @return TRUE if a checkpoint was read, FALSE if there is none
+ */
+static int loadCheckpoint(const char *stateName, Checkpoint *checkpoint)
+{
+    FILE *state = fopen(stateName, "r");
+    if(state == NULL)
+    {
+        return FALSE;
+    }
+    Counts *counts = &checkpoint->counter.counts;
+    int startedWord = FALSE;
+    int read = fscanf(state, "%" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64
+                      " %" SCNu64 " %d %d %" SCNu64, &checkpoint->device, &checkpoint->inode,
+                      &checkpoint->offset, &counts->rows, &counts->words, &counts->characters,
+                      &startedWord, &checkpoint->utf8, &checkpoint->separators);
+    fclose(state);
+    // fscanf returns 9 when it successfully scanned the whole checkpoint
+    if(read != 9)
+    {
+        fprintf(stderr, "Ignoring broken state: %s\n", stateName);
+        checkpoint->device = 0;
+        checkpoint->inode = 0;
+        checkpoint->offset = 0;
+        resetCounter(&checkpoint->counter);
+        checkpoint->utf8 = checkpoint->counter.mode.utf8;
+        checkpoint->separators = hashSeparators(&checkpoint->counter.mode);
+        return FALSE;
+    }
+    counts->startedWord = startedWord ? TRUE : FALSE;
+    return TRUE;
+}
+
+/**
+ * @brief Saves the checkpoint, the state file is replaced at once so a count that is killed
+ * midway never leaves a broken state behind.
+ * @param stateName the path of the state file
+ * @param checkpoint the checkpoint
+ * @return TRUE if the checkpoint was saved
+ */
+static int saveCheckpoint(const char *stateName, const Checkpoint *checkpoint)
+{
+    char *tempName = malloc(strlen(stateName) + sizeof(STATE_TEMP_SUFFIX));
+    if(tempName == NULL)
+    {
+        return FALSE;
+    }
+    strcpy(tempName, stateName);
+    strcat(tempName, STATE_TEMP_SUFFIX);
+    const Counts *counts = &checkpoint->counter.counts;
+    FILE *state = fopen(tempName, "w");
+    int saved = state != NULL;
+    if(saved)
+    {
+        fprintf(state, "%" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+                " %d %d %" PRIu64 "\n", checkpoint->device, checkpoint->inode, checkpoint->offset,
+                counts->rows, counts->words, counts->characters, counts->startedWord,
+                checkpoint->utf8, checkpoint->separators);
+        saved = fclose(state) == 0 && rename(tempName, stateName) == 0;
+    }
+    free(tempName);
+    return saved;
+}
+
+/**
+ * @brief Finds where the last complete utf-8 sequence of the file ends, a sequence that is
+ * still being appended is left for the next count.
+ * @param fd the file descriptor of the file
+ * @param offset the offset the count starts at
+ * @param size the size of the file
+ * @return the end of the part of the file to count
+ */
+static uint64_t completeEnd(int fd, uint64_t offset, uint64_t size)
+{
+    unsigned char tail[UTF8_LOOKAHEAD];
+    size_t available = size - offset < UTF8_LOOKAHEAD ? (size_t)(size - offset) : UTF8_LOOKAHEAD;
+    if(pread(fd, tail, available, (off_t)(size - available)) != (ssize_t)available)
+    {
+        return size;
+    }
+    return size - available + completeUtf8Length(tail, available);
+}
+
+/**
+ * @brief Counts everything appended to the file since the checkpoint and moves the
+ * checkpoint to its end. a file that was replaced or got shorter, or that was counted in
+ * another mode or with other separators, is counted from the start.
+ * @param fd the file descriptor of the file
+ * @param checkpoint the checkpoint
+ * @param threads the maximal amount of counting threads
+ * @return TRUE if the file was counted, FALSE if it isn't a regular file or couldn't be read
+ */
+static int catchUp(int fd, Checkpoint *checkpoint, int threads)
+{
+    Counter *counter = &checkpoint->counter;
+    struct stat info;
+    if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        return FALSE;
+    }
+    uint64_t size = (uint64_t)info.st_size;
+    if(checkpoint->device != (uint64_t)info.st_dev || checkpoint->inode != (uint64_t)info.st_ino ||
+       checkpoint->offset > size || checkpoint->utf8 != counter->mode.utf8 ||
+       checkpoint->separators != hashSeparators(&counter->mode))
+    {
+        checkpoint->device = (uint64_t)info.st_dev;
+        checkpoint->inode = (uint64_t)info.st_ino;
+        checkpoint->offset = 0;
+        resetCounter(counter);
+        checkpoint->utf8 = counter->mode.utf8;
+        checkpoint->separators = hashSeparators(&counter->mode);
+    }
+    if(counter->mode.utf8)
+    {
+        size = completeEnd(fd, checkpoint->offset, size);
+    }
+    if(checkpoint->offset == size)
+    {
+        return TRUE;
+    }
+    if(size - checkpoint->offset <= SIZE_MAX &&
+       countMapped(fd, checkpoint->offset, (size_t)(size - checkpoint->offset), threads,
+                   counter))
+    {
+        checkpoint->offset = size;
+        return TRUE;
+    }
+    // the file couldn't be mapped, read it from the checkpoint to its current end instead
+    off_t end;
+    if(lseek(fd, (off_t)checkpoint->offset, SEEK_SET) < 0 ||
+       !countStream(fd, counter) || (end = lseek(fd, 0, SEEK_CUR)) < 0)
+    {
+        return FALSE;
+    }
+    // the stream may end in the middle of a sequence, which can't be saved in the checkpoint
+    finishCounter(counter);
+    checkpoint->offset = (uint64_t)end;
+    return TRUE;
+}
+
+/**
+ * @brief Waits until the followed file changes.
+ * @param watch the inotify descriptor watching the file, -1 if it couldn't be watched
+ */
+static void waitForChange(int watch)
+{
+#ifdef __linux__
+    char events[sizeof(struct inotify_event) * 16];
+    if(watch >= 0 && read(watch, events, sizeof(events)) > 0)
+    {
+        return;
+    }
+#else
+    (void)watch;
+#endif
+    sleep(FOLLOW_POLL_SECONDS);
+}
+
+/**
+ * @brief Starts watching the file for appends and rotations.
+ * @param fileName the path of the file
+ * @return an inotify descriptor, -1 if the file can't be watched and has to be polled
+ */
+static int watchFile(const char *fileName)
+{
+#ifdef __linux__
+    int watch = inotify_init();
+    if(watch >= 0 && inotify_add_watch(watch, fileName, IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF |
+                                       IN_DELETE_SELF) < 0)
+    {
+        close(watch);
+        watch = -1;
+    }
+    return watch;
+#else
+    (void)fileName;
+    return -1;
+#endif
+}
+
+/**
+ * @brief Counts the file from where the checkpoint in the state file stopped, and with follow
+ * keeps counting whatever is appended to it, printing the totals after every change.
+ * @param fileName the path of the file
+ * @param stateName the path of the state file, NULL to start from the beginning of the file
+ * @param follow whether to wait for appends after the file was counted
+ * @param threads the maximal amount of counting threads
+ * @param options how the file is counted
+ * @return TRUE if the file was counted, FALSE on an error
+ */
+static int countResumable(const char *fileName, const char *stateName, int follow,
+                          int threads, const CounterOptions *options)
+{
+    Checkpoint checkpoint = {.offset = 0};
+    if(!initCounter(&checkpoint.counter, options))
+    {
+        fprintf(stderr, "Out of memory\n");
+        return FALSE;
+    }
+    if(stateName != NULL)
+    {
+        loadCheckpoint(stateName, &checkpoint);
+    }
+    int fd = open(fileName, O_RDONLY);
+    int watch = follow ? watchFile(fileName) : -1;
+    uint64_t printedOffset = UINT64_MAX;
+    while(TRUE)
+    {
+        if(fd < 0 || !catchUp(fd, &checkpoint, threads))
+        {
+            fprintf(stderr, "Can not read file: %s\n", fileName);
+            break;
+        }
+        if(checkpoint.offset != printedOffset)
+        {
+            printCounts(&checkpoint.counter.counts, options->metrics, NULL);
+            fflush(stdout);
+            printedOffset = checkpoint.offset;
+            if(stateName != NULL && !saveCheckpoint(stateName, &checkpoint))
+            {
+                fprintf(stderr, "Can not save state: %s\n", stateName);
+                break;
+            }
+        }
+        if(!follow)
+        {
+            close(fd);
+            freeCounter(&checkpoint.counter);
+            return TRUE;
+        }
+        waitForChange(watch);
+        // a rotated log is replaced by a new file under the same path, the rest of the old one
+        // was counted above so the new one is counted from its beginning
+        struct stat info;
+        while(stat(fileName, &info) != 0)
+        {
+            sleep(FOLLOW_POLL_SECONDS);
+        }
+        if((uint64_t)info.st_ino != checkpoint.inode || (uint64_t)info.st_dev != checkpoint.device)
+        {
+            catchUp(fd, &checkpoint, threads);
+            close(fd);
+            fd = open(fileName, O_RDONLY);
+            if(watch >= 0)
+            {
+                close(watch);
+                watch = watchFile(fileName);
+            }
+        }
+    }
+    if(fd >= 0)
+    {
+        close(fd);
+    }
+    if(watch >= 0)
+    {
+        close(watch);
+    }
+    freeCounter(&checkpoint.counter);
+    return FALSE;
+}
+
+/**
+ * @brief Parses the amount given after THREADS_FLAG or TOP_FLAG.
+ * @param arg the argument
+ * @param max the largest amount allowed
+ * @return the amount, 0 if the argument isn't a number between 1 and max
+ */
+static int parseAmount(const char *arg, int max)
+{
+    char *end;
+    long amount = strtol(arg, &end, 10);
+    if(*arg == '\0' || *end != '\0' || amount < 1 || amount > max)
+    {
+        return 0;
+    }
+    return (int)amount;
+}
+
 /**
  * @brief The main function. the function prints out amount of characters,words and rows used.
+ * with a single file or the standard input -j splits the input between threads, with many
+ * files (or -l) it sets the amount of files counted at once, every online cpu by default.
+ * -s resumes the count of an appended file from a saved state, -f keeps counting its appends.
+ * -u counts code points and unicode white spaces instead of bytes and spaces, -d sets the
+ * bytes that separate words instead of space and -m adds the byte histogram, the longest line
+ * and the average word length. --top prints the most frequent words with their frequencies.
+ * -z decompresses gzip inputs on a thread of their own while they are counted.
+ * @param argc amount of arguments
+ * @param argv the args, an optional amount of threads, -l or any amount of files to count
+ *        instead of the standard input
  * @return 0, to tell the system the execution ended without errors.
  */
-int main()
-{
-	int c = 0;
-	int rows = 1;
-	int words = 0;
-	int characters = 0;
-	int startedWord = FALSE;
-	/* startedWord is an indicator that track whether the function is in the middle of the word 
-	 * or after pressing space or enter keys
-	 */
-	while((c = getchar()) != EOF)
-	{
-		if(c == NL)
-		{
-			rows ++;
-			characters ++;
-            startedWord = FALSE;
-		}
-		else if (c == SPACE)
-		{
-			startedWord = FALSE;
-			characters ++;
-		}
-		else
-		{
-            if(!startedWord)
-            {
-				 words ++;
-			}
-			startedWord = TRUE;
-			characters ++;
-		}	
-	}	
-	printf("Num of Rows:%d words:%d characters:%d\n", rows, words, characters);
-	return 0;
-}
\ No newline at end of file
+int main(int argc, char *argv[])
+{
+    CounterOptions options = {FALSE, FALSE, NULL, FALSE};
+    unsigned char isSeparator[NUM_OF_BYTES];
+    int threads = 0;
+    int top = 0;
+    int fromList = FALSE;
+    int gzip = FALSE;
+    int follow = FALSE;
+    const char *stateName = NULL;
+    int numOfFiles = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], THREADS_FLAG) == 0 && i + 1 < argc &&
+           (threads = parseAmount(argv[i + 1], MAX_THREADS)) != 0)
+        {
+            i++;
+        }
+        else if(strcmp(argv[i], LIST_FLAG) == 0)
+        {
+            fromList = TRUE;
+        }
+        else if(strcmp(argv[i], STATE_FLAG) == 0 && i + 1 < argc)
+        {
+            stateName = argv[++i];
+        }
+        else if(strcmp(argv[i], GZIP_FLAG) == 0)
+        {
+            gzip = TRUE;
+        }
+        else if(strcmp(argv[i], FOLLOW_FLAG) == 0)
+        {
+            follow = TRUE;
+        }
+        else if(strcmp(argv[i], UTF8_FLAG) == 0)
+        {
+            options.utf8 = TRUE;
+        }
+        else if(strcmp(argv[i], SEPARATORS_FLAG) == 0 && i + 1 < argc &&
+                parseSeparators(argv[i + 1], isSeparator))
+        {
+            options.separators = isSeparator;
+            i++;
+        }
+        else if(strcmp(argv[i], METRICS_FLAG) == 0)
+        {
+            options.metrics = TRUE;
+        }
+        else if(strcmp(argv[i], TOP_FLAG) == 0 && i + 1 < argc &&
+                (top = parseAmount(argv[i + 1], MAX_TOP)) != 0)
+        {
+            i++;
+        }
+        else if(argv[i][0] != '-')
+        {
+            // the file names are gathered at the front of argv
+            argv[numOfFiles++] = argv[i];
+        }
+        else
+        {
+            numOfFiles = -1;
+            break;
+        }
+    }
+    // the separators, metrics and top words are of bytes, a saved state holds none of the
+    // metrics and words nor an offset in a gzip stream, and the words are of a single input
+    if(numOfFiles < 0 || (fromList && numOfFiles > 0) ||
+       ((stateName != NULL || follow) &&
+        (fromList || numOfFiles != 1 || options.metrics || gzip)) ||
+       (options.utf8 && (options.separators != NULL || options.metrics || top > 0)) ||
+       (top > 0 && (fromList || numOfFiles > 1 || stateName != NULL || follow)))
+    {
+        fprintf(stderr, "Wrong parameters. Usage:\n"
+                "Count [-u | [-d separators] [-m]] [-z] [-j threads] [-l | file...]\n"
+                "Count [-d separators] [-m] [-z] --top words [file]\n"
+                "Count [-u | -d separators] [-j threads] [-s state] [-f] file\n");
+        return 1;
+    }
+    options.wordFrequencies = top > 0;
+    if(stateName != NULL || follow)
+    {
+        return countResumable(argv[0], stateName, follow, threads > 0 ? threads : 1,
+                              &options) ? 0 : 1;
+    }
+    if(fromList || numOfFiles > 1)
+    {
+        if(threads == 0)
+        {
+            long online = sysconf(_SC_NPROCESSORS_ONLN);
+            threads = online < 1 ? 1 : online > MAX_THREADS ? MAX_THREADS : (int)online;
+        }
+        if(!fromList)
+        {
+            return countFiles(argv, (size_t)numOfFiles, threads, &options, gzip) ? 0 : 1;
+        }
+        size_t numOfListed;
+        char **fileNames = readFileList(&numOfListed);
+        if(fileNames == NULL)
+        {
+            return 1;
+        }
+        int allCounted = countFiles(fileNames, numOfListed, threads, &options, gzip);
+        for (size_t i = 0; i < numOfListed; i++)
+        {
+            free(fileNames[i]);
+        }
+        free(fileNames);
+        return allCounted ? 0 : 1;
+    }
+    if(threads == 0)
+    {
+        threads = 1;
+    }
+    Counter counter;
+    if(!initCounter(&counter, &options))
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    GzipTotals totals = {0, 0};
+    double start = secondsNow();
+    if(numOfFiles == 1 ? !countFile(argv[0], threads, &counter, gzip ? &totals : NULL) :
+       !countFd(STDIN_FD, threads, &counter, gzip ? &totals : NULL))
+    {
+        if(numOfFiles == 0)
+        {
+            fprintf(stderr, "Can not read the input\n");
+        }
+        freeCounter(&counter);
+        return 1;
+    }
+    int finished = finishCounter(&counter);
+    if(counter.counts.invalid)
+    {
+        fprintf(stderr, "Warning: the input isn't valid utf-8\n");
+    }
+    printCounts(&counter.counts, options.metrics, NULL);
+    if(gzip)
+    {
+        printThroughput(&totals, secondsNow() - start);
+    }
+    int printed = !finished || top == 0 || printTopWords(&counter, (size_t)top);
+    freeCounter(&counter);
+    if(!finished || !printed)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    return 0;
+}
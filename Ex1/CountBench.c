@@ -0,0 +1,680 @@
+/**
+ * @file CountBench.c
+ * @author  Vitaly Frolov vitaly.frolov@mail.huji.ac.il
+ * @version 1.0
+ * @date 1 Nov 2015
+ *
+ * @brief Benchmark of the counter library behind Count, over synthetic corpora.
+ *
+
+ * @section DESCRIPTION
+ * Generates reproducible corpora and measures how fast the counter goes through them.
+ * Input  : The sizes of the corpora, optionally their kinds, the amount of runs and threads.
+ * Process: Generates every corpus once into a file, then counts it with a cold and a warm
+ *          page cache.
+ * Output : A CSV line per corpus and cache with the GB/s, its variance and the cycles/byte.
+ */
+
+ // ------------------------------ includes -----------------------------
+// needed for posix_fadvise and clock_gettime under -std=c99
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+/**
+ * @def HAS_TSC
+ * @brief A macro that marks that the time stamp counter can be read, for the cycles/byte.
+ */
+#define HAS_TSC
+#endif
+#include "Counter.h"
+
+// -------------------------- const definitions -------------------------
+/**
+ * @def TRUE 1
+ * @brief A macro that sets true value to be 1.
+ */
+#define TRUE 1
+/**
+ * @def FALSE 0
+ * @brief A macro that sets false value to be 0.
+ */
+#define FALSE 0
+/**
+ * @def NL 10
+ * @brief A macro that sets the new line ASCII code.
+ */
+#define NL 10
+/**
+ * @def SPACE 32
+ * @brief A macro that sets the space key ASCII code.
+ */
+#define SPACE 32
+/**
+ * @def RUNS_FLAG "-r"
+ * @brief A macro that sets the flag that is followed by the amount of measured runs.
+ */
+#define RUNS_FLAG "-r"
+/**
+ * @def THREADS_FLAG "-j"
+ * @brief A macro that sets the flag that is followed by the amount of counting threads.
+ */
+#define THREADS_FLAG "-j"
+/**
+ * @def KIND_FLAG "-k"
+ * @brief A macro that sets the flag that is followed by a kind of corpus to benchmark, all
+ * the kinds are benchmarked without it.
+ */
+#define KIND_FLAG "-k"
+/**
+ * @def DIRECTORY_FLAG "-d"
+ * @brief A macro that sets the flag that is followed by the directory the corpora are kept in.
+ */
+#define DIRECTORY_FLAG "-d"
+/**
+ * @def GENERATE_FLAG "-g"
+ * @brief A macro that sets the flag that only generates a corpus, followed by its kind, size
+ * and path.
+ */
+#define GENERATE_FLAG "-g"
+/**
+ * @def DEFAULT_RUNS 5
+ * @brief A macro that sets the amount of measured runs of every corpus and cache.
+ */
+#define DEFAULT_RUNS 5
+/**
+ * @def MAX_RUNS 1000
+ * @brief A macro that sets the most measured runs.
+ */
+#define MAX_RUNS 1000
+/**
+ * @def MAX_SIZES 64
+ * @brief A macro that sets the most corpus sizes benchmarked at once.
+ */
+#define MAX_SIZES 64
+/**
+ * @def BLOCK_SIZE 1048576
+ * @brief A macro that sets the size of the blocks a corpus is generated in.
+ */
+#define BLOCK_SIZE 1048576
+/**
+ * @def MAX_TOKEN 8
+ * @brief A macro that sets the most bytes a generator adds to a block at once.
+ */
+#define MAX_TOKEN 8
+/**
+ * @def SEED 0x9E3779B97F4A7C15
+ * @brief A macro that sets the seed of every corpus, so they are the same on every run.
+ */
+#define SEED 0x9E3779B97F4A7C15ULL
+/**
+ * @def SHORT_LINE 40
+ * @brief A macro that sets the average length of the lines of the short lines corpus.
+ */
+#define SHORT_LINE 40
+/**
+ * @def LONG_LINE 65536
+ * @brief A macro that sets the average length of the lines of the long lines corpus.
+ */
+#define LONG_LINE 65536
+/**
+ * @def UTF8_LINE 80
+ * @brief A macro that sets the average amount of code points in a line of the utf-8 corpus.
+ */
+#define UTF8_LINE 80
+/**
+ * @def BYTES_IN_GB 1e9
+ * @brief A macro that sets the amount of bytes in the gigabytes the speed is given in.
+ */
+#define BYTES_IN_GB 1e9
+/**
+ * @def MAX_PATH 4096
+ * @brief A macro that sets the longest path of a corpus file.
+ */
+#define MAX_PATH 4096
+
+/**
+ * @enum CorpusKind
+ * @brief The kinds of generated corpora.
+ */
+typedef enum CorpusKind
+{
+    ALL_SPACES,
+    NO_SPACES,
+    SHORT_LINES,
+    LONG_LINES,
+    RANDOM_UTF8,
+    NUM_OF_KINDS
+} CorpusKind;
+
+/**
+ * The names of the corpus kinds, as given after KIND_FLAG and printed in the results.
+ */
+static const char *const KIND_NAMES[NUM_OF_KINDS] = {"spaces", "nospaces", "short", "long",
+                                                     "utf8"};
+
+/**
+ * @struct Generator
+ * @brief The state of the generation of a corpus, carried from one block to the next.
+ */
+typedef struct Generator
+{
+    CorpusKind kind;
+    uint64_t random;
+    // the amount of tokens left in the current line
+    uint64_t lineLeft;
+} Generator;
+
+/**
+ * @struct Measurement
+ * @brief The results of the runs over one corpus with one state of the page cache.
+ */
+typedef struct Measurement
+{
+    double gigabytesPerSecond[MAX_RUNS];
+    double cyclesPerByte[MAX_RUNS];
+    int runs;
+} Measurement;
+
+// ------------------------------ functions -----------------------------
+/**
+ * @brief The next number of the xorshift64* generator of the corpus.
+ * @param generator the generator
+ * @return a pseudo random number
+ */
+static uint64_t nextRandom(Generator *generator)
+{
+    generator->random ^= generator->random >> 12;
+    generator->random ^= generator->random << 25;
+    generator->random ^= generator->random >> 27;
+    return generator->random * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief Writes the utf-8 encoding of the code point.
+ * @param codePoint the code point, not a surrogate
+ * @param bytes at least 4 bytes
+ * @return the amount of bytes written
+ */
+static int encodeUtf8(uint32_t codePoint, unsigned char *bytes)
+{
+    if(codePoint < 0x80)
+    {
+        bytes[0] = (unsigned char)codePoint;
+        return 1;
+    }
+    if(codePoint < 0x800)
+    {
+        bytes[0] = (unsigned char)(0xC0 | codePoint >> 6);
+        bytes[1] = (unsigned char)(0x80 | (codePoint & 0x3F));
+        return 2;
+    }
+    if(codePoint < 0x10000)
+    {
+        bytes[0] = (unsigned char)(0xE0 | codePoint >> 12);
+        bytes[1] = (unsigned char)(0x80 | (codePoint >> 6 & 0x3F));
+        bytes[2] = (unsigned char)(0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    bytes[0] = (unsigned char)(0xF0 | codePoint >> 18);
+    bytes[1] = (unsigned char)(0x80 | (codePoint >> 12 & 0x3F));
+    bytes[2] = (unsigned char)(0x80 | (codePoint >> 6 & 0x3F));
+    bytes[3] = (unsigned char)(0x80 | (codePoint & 0x3F));
+    return 4;
+}
+
+/**
+ * @brief Generates the next token of a corpus of words, a letter or the space or new line
+ * after a word.
+ * @param generator the generator
+ * @param lineLength the average amount of tokens in a line
+ * @param token at least MAX_TOKEN bytes
+ * @return the length of the token
+ */
+static int wordToken(Generator *generator, uint64_t lineLength, unsigned char *token)
+{
+    uint64_t random = nextRandom(generator);
+    if(generator->lineLeft == 0)
+    {
+        generator->lineLeft = 1 + random % (2 * lineLength);
+        token[0] = NL;
+        return 1;
+    }
+    generator->lineLeft--;
+    // words of 5 letters on average
+    token[0] = (random >> 32) % 6 == 0 ? SPACE : (unsigned char)('a' + (random >> 40) % 26);
+    return 1;
+}
+
+/**
+ * @brief Generates the next token of the utf-8 corpus, a code point of 1 to 4 bytes, a
+ * unicode white space or a new line.
+ * @param generator the generator
+ * @param token at least MAX_TOKEN bytes
+ * @return the length of the token
+ */
+static int utf8Token(Generator *generator, unsigned char *token)
+{
+    uint64_t random = nextRandom(generator);
+    if(generator->lineLeft == 0)
+    {
+        generator->lineLeft = 1 + random % (2 * UTF8_LINE);
+        token[0] = NL;
+        return 1;
+    }
+    generator->lineLeft--;
+    uint32_t value = (uint32_t)(random >> 32);
+    switch(random % 8)
+    {
+        case 0:
+            return encodeUtf8(random & 0x100 ? SPACE : 0x3000, token);
+        case 1:
+        case 2:
+        case 3:
+            return encodeUtf8('!' + value % 94, token);
+        case 4:
+            return encodeUtf8(0x80 + value % 0x780, token);
+        case 5:
+        case 6:
+            // skip the surrogates
+            return encodeUtf8(0x800 + value % 0xD000, token);
+        default:
+            return encodeUtf8(0x10000 + value % 0x100000, token);
+    }
+}
+
+/**
+ * @brief Fills a block of the corpus. a token that doesn't fit in the block is replaced by
+ * spaces, so the corpus is exactly its size and never ends within a utf-8 sequence.
+ * @param generator the generator
+ * @param block the block
+ * @param length the length of the block
+ */
+static void generateBlock(Generator *generator, unsigned char *block, size_t length)
+{
+    if(generator->kind == ALL_SPACES)
+    {
+        memset(block, SPACE, length);
+        return;
+    }
+    size_t i = 0;
+    unsigned char token[MAX_TOKEN];
+    while(i < length)
+    {
+        int tokenLength;
+        switch(generator->kind)
+        {
+            case NO_SPACES:
+                token[0] = (unsigned char)('a' + (nextRandom(generator) >> 40) % 26);
+                tokenLength = 1;
+                break;
+            case SHORT_LINES:
+                tokenLength = wordToken(generator, SHORT_LINE, token);
+                break;
+            case LONG_LINES:
+                tokenLength = wordToken(generator, LONG_LINE, token);
+                break;
+            default:
+                tokenLength = utf8Token(generator, token);
+        }
+        if(i + (size_t)tokenLength > length)
+        {
+            memset(block + i, SPACE, length - i);
+            return;
+        }
+        memcpy(block + i, token, (size_t)tokenLength);
+        i += (size_t)tokenLength;
+    }
+}
+
+/**
+ * @brief Writes a corpus into a file.
+ * @param kind the kind of the corpus
+ * @param size the size of the corpus in bytes
+ * @param path the path of the file
+ * @return TRUE if the corpus was written
+ */
+static int generateCorpus(CorpusKind kind, uint64_t size, const char *path)
+{
+    unsigned char *block = malloc(BLOCK_SIZE);
+    FILE *file = fopen(path, "wb");
+    int written = block != NULL && file != NULL;
+    Generator generator = {kind, SEED, 0};
+    for (uint64_t offset = 0; written && offset < size; offset += BLOCK_SIZE)
+    {
+        size_t length = size - offset < BLOCK_SIZE ? (size_t)(size - offset) : BLOCK_SIZE;
+        generateBlock(&generator, block, length);
+        written = fwrite(block, 1, length, file) == length;
+    }
+    if(file != NULL)
+    {
+        written = fclose(file) == 0 && written;
+    }
+    free(block);
+    if(!written)
+    {
+        fprintf(stderr, "Can not write file: %s\n", path);
+    }
+    return written;
+}
+
+/**
+ * @brief The time of a monotonic clock.
+ * @return the time in seconds
+ */
+static double secondsNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief The time stamp counter, which counts cycles at the nominal frequency of the cpu.
+ * @return the counter, 0 where it can't be read
+ */
+static uint64_t cyclesNow(void)
+{
+#ifdef HAS_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Counts a corpus file once, the way Count counts a file.
+ * @param path the path of the corpus
+ * @param kind the kind of the corpus, the utf-8 corpus is counted as utf-8
+ * @param threads the maximal amount of counting threads
+ * @param cold whether to drop the file from the page cache before the count
+ * @param measurement the speed of the count is added to it
+ * @return TRUE if the corpus was counted
+ */
+static int measureRun(const char *path, CorpusKind kind, int threads, int cold,
+                      Measurement *measurement)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if(fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        fprintf(stderr, "Can not read file: %s\n", path);
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        return FALSE;
+    }
+    size_t size = (size_t)info.st_size;
+    if(cold)
+    {
+        // the file was synced when it was generated, so its pages are clean and can be dropped
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    CounterOptions options = {kind == RANDOM_UTF8, FALSE, NULL, FALSE};
+    Counter counter;
+    initCounter(&counter, &options);
+    double start = secondsNow();
+    uint64_t startCycles = cyclesNow();
+    unsigned char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED)
+    {
+        close(fd);
+        return FALSE;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+    feedCounterParallel(&counter, data, size, threads);
+    finishCounter(&counter);
+    munmap(data, size);
+    uint64_t cycles = cyclesNow() - startCycles;
+    double seconds = secondsNow() - start;
+    close(fd);
+    freeCounter(&counter);
+    int run = measurement->runs++;
+    measurement->gigabytesPerSecond[run] = (double)size / BYTES_IN_GB / seconds;
+    measurement->cyclesPerByte[run] = (double)cycles / (double)size;
+    return TRUE;
+}
+
+/**
+ * @brief The mean of the values.
+ * @param values the values
+ * @param numOfValues the amount of values, at least 1
+ * @return the mean
+ */
+static double mean(const double *values, int numOfValues)
+{
+    double sum = 0;
+    for (int i = 0; i < numOfValues; i++)
+    {
+        sum += values[i];
+    }
+    return sum / numOfValues;
+}
+
+/**
+ * @brief The sample variance of the values.
+ * @param values the values
+ * @param numOfValues the amount of values, at least 1
+ * @return the variance, 0 for a single value
+ */
+static double variance(const double *values, int numOfValues)
+{
+    if(numOfValues < 2)
+    {
+        return 0;
+    }
+    double average = mean(values, numOfValues);
+    double sum = 0;
+    for (int i = 0; i < numOfValues; i++)
+    {
+        sum += (values[i] - average) * (values[i] - average);
+    }
+    return sum / (numOfValues - 1);
+}
+
+/**
+ * @brief Prints the results of a corpus and cache as a CSV line.
+ * @param kind the kind of the corpus
+ * @param size the size of the corpus
+ * @param cache "cold" or "warm"
+ * @param measurement the results of its runs
+ */
+static void printMeasurement(CorpusKind kind, uint64_t size, const char *cache,
+                             const Measurement *measurement)
+{
+    double minimum = INFINITY;
+    double maximum = 0;
+    for (int i = 0; i < measurement->runs; i++)
+    {
+        minimum = fmin(minimum, measurement->gigabytesPerSecond[i]);
+        maximum = fmax(maximum, measurement->gigabytesPerSecond[i]);
+    }
+    double gbVariance = variance(measurement->gigabytesPerSecond, measurement->runs);
+    printf("%s,%" PRIu64 ",%s,%d,%.4f,%.6f,%.4f,%.4f,%.4f,%.4f\n", KIND_NAMES[kind], size,
+           cache, measurement->runs, mean(measurement->gigabytesPerSecond, measurement->runs),
+           gbVariance, sqrt(gbVariance), minimum, maximum,
+           mean(measurement->cyclesPerByte, measurement->runs));
+    fflush(stdout);
+}
+
+/**
+ * @brief Benchmarks a corpus, generating it first when its file doesn't exist yet.
+ * @param kind the kind of the corpus
+ * @param size the size of the corpus
+ * @param directory the directory of the corpus files
+ * @param runs the amount of measured runs of every cache
+ * @param threads the maximal amount of counting threads
+ * @return TRUE if the corpus was benchmarked
+ */
+static int benchmarkCorpus(CorpusKind kind, uint64_t size, const char *directory, int runs,
+                           int threads)
+{
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s/count-%s-%" PRIu64 ".txt", directory, KIND_NAMES[kind],
+             size);
+    struct stat info;
+    if((stat(path, &info) != 0 || (uint64_t)info.st_size != size) &&
+       !generateCorpus(kind, size, path))
+    {
+        return FALSE;
+    }
+    Measurement cold = {.runs = 0};
+    Measurement warm = {.runs = 0};
+    for (int i = 0; i < runs; i++)
+    {
+        if(!measureRun(path, kind, threads, TRUE, &cold))
+        {
+            return FALSE;
+        }
+    }
+    // an unmeasured run brings the whole corpus into the page cache
+    measureRun(path, kind, threads, FALSE, &warm);
+    warm.runs = 0;
+    for (int i = 0; i < runs; i++)
+    {
+        measureRun(path, kind, threads, FALSE, &warm);
+    }
+    printMeasurement(kind, size, "cold", &cold);
+    printMeasurement(kind, size, "warm", &warm);
+    return TRUE;
+}
+
+/**
+ * @brief Parses a size, a number optionally followed by K, M or G (powers of 1024).
+ * @param arg the argument
+ * @return the size in bytes, 0 if the argument isn't a positive size
+ */
+static uint64_t parseSize(const char *arg)
+{
+    char *end;
+    unsigned long long size = strtoull(arg, &end, 10);
+    if(end == arg || arg[0] == '-')
+    {
+        return 0;
+    }
+    const char *units = "KMG";
+    const char *unit = *end == '\0' ? NULL : strchr(units, *end);
+    if(unit != NULL && end[1] == '\0')
+    {
+        size <<= 10 * (unit - units + 1);
+    }
+    else if(*end != '\0')
+    {
+        return 0;
+    }
+    return (uint64_t)size;
+}
+
+/**
+ * @brief Parses the name of a corpus kind.
+ * @param arg the argument
+ * @return the kind, NUM_OF_KINDS if there isn't such a kind
+ */
+static CorpusKind parseKind(const char *arg)
+{
+    int kind = 0;
+    while(kind < NUM_OF_KINDS && strcmp(arg, KIND_NAMES[kind]) != 0)
+    {
+        kind++;
+    }
+    return (CorpusKind)kind;
+}
+
+/**
+ * @brief The main function. benchmarks the counter over every corpus kind (or the ones
+ * given with -k) at every given size, or with -g only generates a corpus.
+ * @param argc amount of arguments
+ * @param argv the args, the flags and the sizes of the corpora
+ * @return 0, to tell the system the execution ended without errors.
+ */
+int main(int argc, char *argv[])
+{
+    int runs = DEFAULT_RUNS;
+    int threads = 1;
+    const char *directory = ".";
+    int kinds[NUM_OF_KINDS] = {FALSE};
+    int anyKind = FALSE;
+    uint64_t sizes[MAX_SIZES];
+    int numOfSizes = 0;
+    int wrong = FALSE;
+    for (int i = 1; i < argc && !wrong; i++)
+    {
+        if(i == 1 && strcmp(argv[i], GENERATE_FLAG) == 0 && argc == 5)
+        {
+            CorpusKind kind = parseKind(argv[2]);
+            uint64_t size = parseSize(argv[3]);
+            if(kind == NUM_OF_KINDS || size == 0)
+            {
+                wrong = TRUE;
+                break;
+            }
+            return generateCorpus(kind, size, argv[4]) ? 0 : 1;
+        }
+        if(strcmp(argv[i], RUNS_FLAG) == 0 && i + 1 < argc)
+        {
+            runs = atoi(argv[++i]);
+            wrong = runs < 1 || runs > MAX_RUNS;
+        }
+        else if(strcmp(argv[i], THREADS_FLAG) == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+            wrong = threads < 1 || threads > MAX_THREADS;
+        }
+        else if(strcmp(argv[i], DIRECTORY_FLAG) == 0 && i + 1 < argc)
+        {
+            directory = argv[++i];
+        }
+        else if(strcmp(argv[i], KIND_FLAG) == 0 && i + 1 < argc)
+        {
+            CorpusKind kind = parseKind(argv[++i]);
+            wrong = kind == NUM_OF_KINDS;
+            if(!wrong)
+            {
+                kinds[kind] = TRUE;
+                anyKind = TRUE;
+            }
+        }
+        else if(numOfSizes < MAX_SIZES && (sizes[numOfSizes] = parseSize(argv[i])) != 0)
+        {
+            numOfSizes++;
+        }
+        else
+        {
+            wrong = TRUE;
+        }
+    }
+    if(wrong || numOfSizes == 0)
+    {
+        fprintf(stderr, "Wrong parameters. Usage:\n"
+                "CountBench [-r runs] [-j threads] [-d directory] [-k kind]... size...\n"
+                "CountBench -g kind size file\n"
+                "kinds: spaces nospaces short long utf8, sizes as 1K 64M 10G\n");
+        return 1;
+    }
+    printf("corpus,bytes,cache,runs,gb_per_s_mean,gb_per_s_variance,gb_per_s_stddev,"
+           "gb_per_s_min,gb_per_s_max,cycles_per_byte\n");
+    for (int i = 0; i < numOfSizes; i++)
+    {
+        for (int kind = 0; kind < NUM_OF_KINDS; kind++)
+        {
+            if((kinds[kind] || !anyKind) &&
+               !benchmarkCorpus((CorpusKind)kind, sizes[i], directory, runs, threads))
+            {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
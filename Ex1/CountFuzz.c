@@ -0,0 +1,344 @@
+/**
+ * @file CountFuzz.c
+ * @author  Vitaly Frolov vitaly.frolov@mail.huji.ac.il
+ * @version 1.0
+ * @date 1 Nov 2015
+ *
+ * @brief Differential fuzzer of the parallel count of the counter library against the serial
+ * one.
+ *
+
+ * @section DESCRIPTION
+ * Counts random inputs with feedCounter and with feedCounterParallel, and stops at the first
+ * input they don't agree on.
+ * Input  : Optionally the seed and the amount of iterations.
+ * Process: Counts the inputs that were counted wrong in the past, then random bytes and utf-8
+ *          after a random start, serially and split between threads.
+ * Output : The seed and the iteration of the first disagreement, or that there was none.
+ */
+
+ // ------------------------------ includes -----------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+#include "Counter.h"
+
+// -------------------------- const definitions -------------------------
+/**
+ * @def TRUE 1
+ * @brief A macro that sets true value to be 1.
+ */
+#define TRUE 1
+/**
+ * @def FALSE 0
+ * @brief A macro that sets false value to be 0.
+ */
+#define FALSE 0
+/**
+ * @def SEED_FLAG "-s"
+ * @brief A macro that sets the flag that is followed by the seed, to repeat a run.
+ */
+#define SEED_FLAG "-s"
+/**
+ * @def DEFAULT_ITERATIONS 200
+ * @brief A macro that sets the amount of iterations unless another one is given.
+ */
+#define DEFAULT_ITERATIONS 200
+/**
+ * @def MAX_LENGTH 6291456
+ * @brief A macro that sets the most bytes of an input, a few of the chunks of the parallel
+ * count.
+ */
+#define MAX_LENGTH 6291456
+/**
+ * @def MAX_PREFIX 4
+ * @brief A macro that sets the most bytes counted serially before an input.
+ */
+#define MAX_PREFIX 4
+/**
+ * @def MAX_FUZZ_THREADS 8
+ * @brief A macro that sets the most threads an input is split between.
+ */
+#define MAX_FUZZ_THREADS 8
+/**
+ * @def SUFFIX "a b\n"
+ * @brief A macro that sets the bytes counted after an input, so the state it ended in shows
+ * in the totals.
+ */
+#define SUFFIX "a b\n"
+
+// ------------------------------ types -----------------------------
+/**
+ * @struct Case
+ * @brief A case of the fuzzer.
+ */
+typedef struct Case
+{
+    size_t length;
+    int utf8;
+    int metrics;
+    int threads;
+    // the bytes counted serially before the input
+    unsigned char prefix[MAX_PREFIX];
+    size_t prefixLength;
+} Case;
+
+// ------------------------------ functions -----------------------------
+/**
+ * @brief The next number of the xorshift64* generator of the fuzzer.
+ * @param random the state of the generator
+ * @return a pseudo random number
+ */
+static uint64_t nextRandom(uint64_t *random)
+{
+    *random ^= *random >> 12;
+    *random ^= *random << 25;
+    *random ^= *random >> 27;
+    return *random * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief A random token of text, words, spaces and new lines, in utf-8 mode with multi byte
+ * characters and white spaces and with broken sequences.
+ * @param random the state of the generator
+ * @param utf8 whether the token is utf-8
+ * @param token will be set to the token, at least 4 bytes
+ * @return the length of the token
+ */
+static size_t randomToken(uint64_t *random, int utf8, unsigned char *token)
+{
+    static const char *const texts[] = {"a", "Z", "7", " ", " ", "\n", "\t", "\xC3\xA9",
+                                        "\xC2\xA0", "\xE3\x80\x80", "\xF0\x9F\x98\x80", "\x80",
+                                        "\xE2\x80", "\xFF"};
+    // the texts after the first 7 aren't ascii, outside utf-8 random bytes are used instead
+    uint64_t value = nextRandom(random);
+    size_t numOfTexts = utf8 ? sizeof(texts) / sizeof(texts[0]) : 7;
+    if(!utf8 && value % 16 == 0)
+    {
+        token[0] = (unsigned char)(value >> 8);
+        return 1;
+    }
+    const char *text = texts[(value >> 4) % numOfTexts];
+    size_t length = strlen(text);
+    memcpy(token, text, length);
+    return length;
+}
+
+/**
+ * @brief Draws a random case and fills the buffer with its input. every few cases the input
+ * begins with continuation bytes, or is made of them alone.
+ * @param random the state of the generator
+ * @param testCase the case
+ * @param buffer the buffer, at least MAX_LENGTH bytes
+ */
+static void drawCase(uint64_t *random, Case *testCase, unsigned char *buffer)
+{
+    testCase->length = (size_t)(nextRandom(random) % (MAX_LENGTH + 1));
+    testCase->utf8 = (int)(nextRandom(random) % 2);
+    testCase->metrics = !testCase->utf8 && nextRandom(random) % 2 == 0;
+    testCase->threads = 2 + (int)(nextRandom(random) % (MAX_FUZZ_THREADS - 1));
+    testCase->prefixLength = 0;
+    size_t prefixLength = (size_t)(nextRandom(random) % (MAX_PREFIX + 1));
+    while(testCase->prefixLength < prefixLength)
+    {
+        unsigned char token[4];
+        size_t length = randomToken(random, testCase->utf8, token);
+        if(testCase->prefixLength + length > MAX_PREFIX)
+        {
+            break;
+        }
+        memcpy(testCase->prefix + testCase->prefixLength, token, length);
+        testCase->prefixLength += length;
+    }
+    size_t i = 0;
+    while(i < testCase->length)
+    {
+        unsigned char token[4];
+        size_t length = randomToken(random, testCase->utf8, token);
+        for (size_t j = 0; j < length && i < testCase->length; j++)
+        {
+            buffer[i++] = token[j];
+        }
+    }
+    uint64_t lead = nextRandom(random) % 8;
+    if(lead == 0)
+    {
+        memset(buffer, 0x80, testCase->length);
+    }
+    else if(lead == 1 && testCase->length > 0)
+    {
+        buffer[0] = 0x80;
+    }
+}
+
+/**
+ * @brief Sets the case of an input that was counted wrong in the past.
+ * @param iteration the iteration, the first ones are the past inputs
+ * @param testCase the case
+ * @param buffer the buffer, at least MAX_LENGTH bytes
+ * @return TRUE if the iteration is of a past input
+ */
+static int regressionCase(uint64_t iteration, Case *testCase, unsigned char *buffer)
+{
+    if(iteration > 1)
+    {
+        return FALSE;
+    }
+    *testCase = (Case){.length = 4194304, .utf8 = TRUE, .threads = 4, .prefixLength = 1};
+    if(iteration == 0)
+    {
+        // a continuation byte after a word was taken for the start of another one
+        testCase->prefix[0] = 'x';
+        for (size_t i = 0; i < testCase->length; i++)
+        {
+            buffer[i] = (unsigned char)"ab cd \n"[i % 7];
+        }
+        buffer[0] = 0x80;
+    }
+    else
+    {
+        // a chunk of continuation bytes alone lost the word it continued
+        testCase->prefix[0] = ' ';
+        memset(buffer, 0x80, testCase->length);
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Counts the input of the case, after its prefix and before the suffix.
+ * @param testCase the case
+ * @param buffer the input
+ * @param threads the threads the input is split between, 0 to count it serially
+ * @param counts will be set to the totals
+ * @return TRUE if the input was counted, FALSE if the memory ran out
+ */
+static int countCase(const Case *testCase, const unsigned char *buffer, int threads,
+                     Counts *counts)
+{
+    Counter counter;
+    CounterOptions options = {.utf8 = testCase->utf8, .metrics = testCase->metrics};
+    if(!initCounter(&counter, &options))
+    {
+        return FALSE;
+    }
+    feedCounter(&counter, testCase->prefix, testCase->prefixLength);
+    if(threads > 0)
+    {
+        feedCounterParallel(&counter, buffer, testCase->length, threads);
+    }
+    else
+    {
+        feedCounter(&counter, buffer, testCase->length);
+    }
+    feedCounter(&counter, SUFFIX, strlen(SUFFIX));
+    finishCounter(&counter);
+    *counts = counter.counts;
+    freeCounter(&counter);
+    return TRUE;
+}
+
+/**
+ * @brief checks if the serial and the parallel totals are the same.
+ * @param serial the totals of the serial count
+ * @param parallel the totals of the parallel count
+ * @return TRUE\FALSE
+ */
+static int sameCounts(const Counts *serial, const Counts *parallel)
+{
+    return serial->rows == parallel->rows && serial->words == parallel->words &&
+           serial->characters == parallel->characters && serial->invalid == parallel->invalid &&
+           serial->metrics.wordBytes == parallel->metrics.wordBytes &&
+           longestLine(&serial->metrics) == longestLine(&parallel->metrics) &&
+           memcmp(serial->metrics.histogram, parallel->metrics.histogram,
+                  sizeof(serial->metrics.histogram)) == 0;
+}
+
+/**
+ * @brief Prints the case the serial and the parallel count disagree on.
+ * @param seed the seed of the run
+ * @param iteration the iteration of the case
+ * @param testCase the case
+ * @param serial the totals of the serial count
+ * @param parallel the totals of the parallel count
+ */
+static void printDisagreement(uint64_t seed, uint64_t iteration, const Case *testCase,
+                              const Counts *serial, const Counts *parallel)
+{
+    printf("Disagreement seed:%" PRIu64 " iteration:%" PRIu64 " length:%zu utf8:%d "
+           "metrics:%d threads:%d prefix:%zu rows:%" PRIu64 "/%" PRIu64 " words:%" PRIu64
+           "/%" PRIu64 " characters:%" PRIu64 "/%" PRIu64 "\n", seed, iteration,
+           testCase->length, testCase->utf8, testCase->metrics, testCase->threads,
+           testCase->prefixLength, serial->rows, parallel->rows, serial->words, parallel->words,
+           serial->characters, parallel->characters);
+}
+
+/**
+ * @brief The main function. counts the past inputs and random ones serially and in parallel
+ * until the counts disagree or the iterations are done.
+ * @param argc amount of arguments
+ * @param argv the args, -s and the seed and the amount of iterations
+ * @return 0 if they always agreed, 1 otherwise
+ */
+int main(int argc, char *argv[])
+{
+    uint64_t seed = (uint64_t)time(NULL);
+    uint64_t iterations = DEFAULT_ITERATIONS;
+    int wrong = FALSE;
+    for (int i = 1; i < argc && !wrong; i++)
+    {
+        char *end;
+        if(strcmp(argv[i], SEED_FLAG) == 0 && i + 1 < argc)
+        {
+            seed = strtoull(argv[++i], &end, 10);
+            wrong = *argv[i] == '\0' || *end != '\0';
+        }
+        else
+        {
+            iterations = strtoull(argv[i], &end, 10);
+            wrong = *argv[i] == '\0' || *end != '\0' || iterations == 0;
+        }
+    }
+    if(wrong)
+    {
+        fprintf(stderr, "Wrong parameters. Usage:\n"
+                "CountFuzz [-s seed] [iterations]\n");
+        return 1;
+    }
+    unsigned char *buffer = malloc(MAX_LENGTH);
+    if(buffer == NULL)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    // a zero seed would keep the generator at zero
+    uint64_t random = seed == 0 ? 1 : seed;
+    for (uint64_t iteration = 0; iteration < iterations; iteration++)
+    {
+        Case testCase;
+        if(!regressionCase(iteration, &testCase, buffer))
+        {
+            drawCase(&random, &testCase, buffer);
+        }
+        Counts serial;
+        Counts parallel;
+        if(!countCase(&testCase, buffer, 0, &serial) ||
+           !countCase(&testCase, buffer, testCase.threads, &parallel))
+        {
+            fprintf(stderr, "Out of memory\n");
+            free(buffer);
+            return 1;
+        }
+        if(!sameCounts(&serial, &parallel))
+        {
+            printDisagreement(seed, iteration, &testCase, &serial, &parallel);
+            free(buffer);
+            return 1;
+        }
+    }
+    printf("Iterations:%" PRIu64 " seed:%" PRIu64 " identical\n", iterations, seed);
+    free(buffer);
+    return 0;
+}
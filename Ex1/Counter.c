@@ -0,0 +1,1547 @@
+/**
+ * @file Counter.c
+ * @author  Vitaly Frolov vitaly.frolov@mail.huji.ac.il
+ * @version 1.0
+ * @date 1 Nov 2015
+ *
+ * @brief A library that counts the rows, words and characters of an input fed to it in
+ * buffers.
+ *
+
+ * @section DESCRIPTION
+ * The counting kernels behind Count, a scalar one and SSE2\AVX2 ones picked at runtime,
+ * for bytes and for utf-8.
+ * Input  : The buffers of the input, in order.
+ * Process: Counts the rows, words and characters, optionally with metrics and the frequency
+ *          of every word.
+ * Output : The counts in the Counter.
+ */
+
+ // ------------------------------ includes -----------------------------
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "Counter.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+/**
+ * @def X86_SIMD
+ * @brief A macro that marks that the SSE2\AVX2 counting kernels are compiled in.
+ */
+#define X86_SIMD
+#endif
+
+// -------------------------- const definitions -------------------------
+/**
+ * @def NL 10
+ * @brief A macro that sets the new line ASCII code.
+ */
+#define NL 10
+/**
+ * @def SPACE 32
+ * @brief A macro that sets the space key ASCII code.
+ */
+#define SPACE 32
+/**
+ * @def TRUE 1
+ * @brief A macro that sets true value to be 1.
+ */
+#define TRUE 1
+/**
+ * @def TRUE 1
+ * @brief A macro that sets false value to be 0.
+ */
+#define FALSE 0
+/**
+ * @def BLOCK_SIZE 64
+ * @brief A macro that sets the amount of bytes classified at once by the vector kernels,
+ * one bit of a 64 bit mask per byte.
+ */
+#define BLOCK_SIZE 64
+/**
+ * @def MAX_COMPARED_SEPARATORS 4
+ * @brief A macro that sets the most separators the vector kernels compare each byte with,
+ * more separators are looked up in a nibble bitmap.
+ */
+#define MAX_COMPARED_SEPARATORS 4
+/**
+ * @def HISTOGRAM_BANKS 4
+ * @brief A macro that sets the amount of histograms adjacent bytes are spread over, so
+ * repeated bytes don't wait for each other's increments.
+ */
+#define HISTOGRAM_BANKS 4
+/**
+ * @def CONTINUATION_MASK 0xC0
+ * @brief A macro that sets the bits that tell a utf-8 continuation byte.
+ */
+#define CONTINUATION_MASK 0xC0
+/**
+ * @def CONTINUATION 0x80
+ * @brief A macro that sets the value of the CONTINUATION_MASK bits of a continuation byte.
+ */
+#define CONTINUATION 0x80
+/**
+ * @def MIN_CHUNK_SIZE 1048576
+ * @brief A macro that sets the smallest part of a file worth a thread of its own.
+ */
+#define MIN_CHUNK_SIZE 1048576
+/**
+ * @def ARENA_BLOCK_SIZE 1048576
+ * @brief A macro that sets the size of the blocks the words are copied into.
+ */
+#define ARENA_BLOCK_SIZE 1048576
+/**
+ * @def INITIAL_TABLE_SIZE 65536
+ * @brief A macro that sets the amount of slots the word table starts with, a power of 2.
+ */
+#define INITIAL_TABLE_SIZE 65536
+/**
+ * @def FNV_OFFSET 14695981039346656037
+ * @brief A macro that sets the initial value of the FNV-1a hash.
+ */
+#define FNV_OFFSET 14695981039346656037ULL
+/**
+ * @def FNV_PRIME 1099511628211
+ * @brief A macro that sets the multiplier of the FNV-1a hash.
+ */
+#define FNV_PRIME 1099511628211ULL
+
+/**
+ * @enum ByteClass
+ * @brief The role of a byte in the count.
+ */
+typedef enum ByteClass
+{
+    WORD_CLASS,
+    SEPARATOR_CLASS,
+    // separates both words and rows
+    NEW_LINE_CLASS
+} ByteClass;
+
+/**
+ * @struct Chunk
+ * @brief One part of a mapped file counted by its own thread.
+ */
+typedef struct Chunk
+{
+    const unsigned char *buffer;
+    size_t length;
+    const CountMode *mode;
+    // the chunk is counted as if it was the beginning of the input, rows start at 0
+    Counts counts;
+    pthread_t thread;
+} Chunk;
+
+// ------------------------------ functions -----------------------------
+/**
+ * @brief Ends a line for the metrics.
+ * @param metrics the metrics
+ * @param length the length of the line without its new line
+ */
+static inline void endLine(Metrics *metrics, uint64_t length)
+{
+    if(!metrics->endedFirstLine)
+    {
+        metrics->firstLine = length;
+        metrics->endedFirstLine = TRUE;
+    }
+    if(length > metrics->longestLine)
+    {
+        metrics->longestLine = length;
+    }
+    metrics->currentLine = 0;
+}
+
+/**
+ * @brief Counts the buffer one byte at a time, used for the tail of the vector kernels and
+ * on machines without them.
+ * @param mode how the input is counted
+ * @param counts the running totals
+ * @param buffer the bytes to count
+ * @param length the amount of bytes in the buffer
+ */
+static void countScalar(const CountMode *mode, Counts *counts, const unsigned char *buffer,
+                        size_t length)
+{
+    Metrics *metrics = &counts->metrics;
+    for (size_t i = 0; i < length; i++)
+    {
+        switch(mode->classes[buffer[i]])
+        {
+            case NEW_LINE_CLASS:
+                counts->rows ++;
+                counts->startedWord = FALSE;
+                if(mode->metrics)
+                {
+                    endLine(metrics, metrics->currentLine);
+                }
+                break;
+            case SEPARATOR_CLASS:
+                counts->startedWord = FALSE;
+                metrics->currentLine += (uint64_t)mode->metrics;
+                break;
+            default:
+                if(!counts->startedWord)
+                {
+                    counts->words ++;
+                }
+                counts->startedWord = TRUE;
+                metrics->currentLine += (uint64_t)mode->metrics;
+                metrics->wordBytes += (uint64_t)mode->metrics;
+        }
+        if(mode->metrics)
+        {
+            metrics->histogram[buffer[i]] ++;
+        }
+    }
+    counts->characters += length;
+}
+
+/**
+ * @brief Adds a classified block of BLOCK_SIZE bytes to the totals. bit i of each mask
+ * stands for byte i of the block.
+ * @param counts the running totals
+ * @param newLines mask of the new line bytes
+ * @param separators mask of the bytes that separate words, new lines included
+ */
+static inline void countBlock(Counts *counts, uint64_t newLines, uint64_t separators)
+{
+    uint64_t wordChars = ~separators;
+    // a word starts at a word char whose previous byte isn't one, the byte before the block
+    // is represented by startedWord
+    uint64_t previous = (wordChars << 1) | (uint64_t)counts->startedWord;
+    counts->words += (uint64_t)__builtin_popcountll(wordChars & ~previous);
+    counts->rows += (uint64_t)__builtin_popcountll(newLines);
+    counts->characters += BLOCK_SIZE;
+    counts->startedWord = (int)(wordChars >> (BLOCK_SIZE - 1));
+}
+
+/**
+ * @brief Adds a classified block of BLOCK_SIZE bytes to the metrics.
+ * @param metrics the metrics
+ * @param block the bytes of the block
+ * @param newLines mask of the new line bytes
+ * @param separators mask of the bytes that separate words, new lines included
+ * @param banks the histograms the bytes are spread over
+ */
+static inline void measureBlock(Metrics *metrics, const unsigned char *block, uint64_t newLines,
+                                uint64_t separators, uint64_t banks[][NUM_OF_BYTES])
+{
+    for (int j = 0; j < BLOCK_SIZE; j += HISTOGRAM_BANKS)
+    {
+        for (int bank = 0; bank < HISTOGRAM_BANKS; bank++)
+        {
+            banks[bank][block[j + bank]] ++;
+        }
+    }
+    metrics->wordBytes += (uint64_t)__builtin_popcountll(~separators);
+    uint64_t lineStart = 0;
+    while(newLines != 0)
+    {
+        uint64_t end = (uint64_t)__builtin_ctzll(newLines);
+        endLine(metrics, metrics->currentLine + end - lineStart);
+        lineStart = end + 1;
+        newLines &= newLines - 1;
+    }
+    metrics->currentLine += BLOCK_SIZE - lineStart;
+}
+
+/**
+ * @brief Adds the histograms the vector kernels spread the bytes over to the metrics.
+ * @param metrics the metrics
+ * @param banks the histograms
+ */
+static void addBanks(Metrics *metrics, uint64_t banks[][NUM_OF_BYTES])
+{
+    for (int bank = 0; bank < HISTOGRAM_BANKS; bank++)
+    {
+        for (int c = 0; c < NUM_OF_BYTES; c++)
+        {
+            metrics->histogram[c] += banks[bank][c];
+        }
+    }
+}
+
+#ifdef X86_SIMD
+/**
+ * @brief Counts the buffer 64 bytes at a time using four 16 byte SSE2 compares per mask,
+ * used when there are at most MAX_COMPARED_SEPARATORS separators.
+ * @param mode how the input is counted
+ * @param counts the running totals
+ * @param buffer the bytes to count
+ * @param length the amount of bytes in the buffer
+ */
+__attribute__((target("sse2")))
+static void countSse2(const CountMode *mode, Counts *counts, const unsigned char *buffer,
+                      size_t length)
+{
+    const __m128i newLine = _mm_set1_epi8(NL);
+    __m128i compared[MAX_COMPARED_SEPARATORS];
+    for (int k = 0; k < mode->numOfSeparators; k++)
+    {
+        compared[k] = _mm_set1_epi8((char)mode->separatorList[k]);
+    }
+    uint64_t banks[HISTOGRAM_BANKS][NUM_OF_BYTES];
+    if(mode->metrics)
+    {
+        memset(banks, 0, sizeof(banks));
+    }
+    size_t i = 0;
+    for (; i + BLOCK_SIZE <= length; i += BLOCK_SIZE)
+    {
+        uint64_t newLines = 0;
+        uint64_t separators = 0;
+        for (int j = 0; j < BLOCK_SIZE; j += 16)
+        {
+            __m128i bytes = _mm_loadu_si128((const __m128i *)(buffer + i + j));
+            __m128i found = _mm_cmpeq_epi8(bytes, newLine);
+            newLines |= (uint64_t)(uint16_t)_mm_movemask_epi8(found) << j;
+            for (int k = 0; k < mode->numOfSeparators; k++)
+            {
+                found = _mm_or_si128(found, _mm_cmpeq_epi8(bytes, compared[k]));
+            }
+            separators |= (uint64_t)(uint16_t)_mm_movemask_epi8(found) << j;
+        }
+        countBlock(counts, newLines, separators);
+        if(mode->metrics)
+        {
+            measureBlock(&counts->metrics, buffer + i, newLines, separators, banks);
+        }
+    }
+    if(mode->metrics)
+    {
+        addBanks(&counts->metrics, banks);
+    }
+    countScalar(mode, counts, buffer + i, length - i);
+}
+
+/**
+ * @brief Finds the separators among 32 bytes, by compares when there are few of them or
+ * by looking the bytes up in the nibble bitmaps of the mode.
+ * @param bytes the bytes
+ * @param compared the separators other than new line, one in every byte
+ * @param numOfCompared the amount of compared separators, more than
+ *        MAX_COMPARED_SEPARATORS to use the bitmaps
+ * @param lowBitmap the low bitmap of the mode in both lanes
+ * @param highBitmap the high bitmap of the mode in both lanes
+ * @return a vector with 0xFF at the separators that aren't new lines
+ */
+__attribute__((target("avx2")))
+static inline __m256i findSeparators(__m256i bytes, const __m256i *compared, int numOfCompared,
+                                     __m256i lowBitmap, __m256i highBitmap)
+{
+    if(numOfCompared <= MAX_COMPARED_SEPARATORS)
+    {
+        __m256i found = _mm256_setzero_si256();
+        for (int k = 0; k < numOfCompared; k++)
+        {
+            found = _mm256_or_si256(found, _mm256_cmpeq_epi8(bytes, compared[k]));
+        }
+        return found;
+    }
+    const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+    const __m256i bitOfHighNibble = _mm256_setr_epi8(
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m256i low = _mm256_and_si256(bytes, lowNibble);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), lowNibble);
+    // the top bit of a byte picks the bitmap of the high nibbles 8 to 15
+    __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(lowBitmap, low),
+                                     _mm256_shuffle_epi8(highBitmap, low), bytes);
+    __m256i bit = _mm256_shuffle_epi8(bitOfHighNibble, high);
+    return _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit);
+}
+
+/**
+ * @brief Counts the buffer 64 bytes at a time using two 32 byte AVX2 classifications per
+ * mask.
+ * @param mode how the input is counted
+ * @param counts the running totals
+ * @param buffer the bytes to count
+ * @param length the amount of bytes in the buffer
+ */
+__attribute__((target("avx2,popcnt")))
+static void countAvx2(const CountMode *mode, Counts *counts, const unsigned char *buffer,
+                      size_t length)
+{
+    const __m256i newLine = _mm256_set1_epi8(NL);
+    __m256i compared[MAX_COMPARED_SEPARATORS];
+    int numOfCompared = mode->numOfSeparators;
+    for (int k = 0; k < numOfCompared && k < MAX_COMPARED_SEPARATORS; k++)
+    {
+        compared[k] = _mm256_set1_epi8((char)mode->separatorList[k]);
+    }
+    const __m256i lowBitmap = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)mode->lowBitmap));
+    const __m256i highBitmap = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)mode->highBitmap));
+    uint64_t banks[HISTOGRAM_BANKS][NUM_OF_BYTES];
+    if(mode->metrics)
+    {
+        memset(banks, 0, sizeof(banks));
+    }
+    size_t i = 0;
+    for (; i + BLOCK_SIZE <= length; i += BLOCK_SIZE)
+    {
+        __m256i low = _mm256_loadu_si256((const __m256i *)(buffer + i));
+        __m256i high = _mm256_loadu_si256((const __m256i *)(buffer + i + 32));
+        __m256i lowNewLines = _mm256_cmpeq_epi8(low, newLine);
+        __m256i highNewLines = _mm256_cmpeq_epi8(high, newLine);
+        uint64_t newLines = (uint32_t)_mm256_movemask_epi8(lowNewLines) |
+                (uint64_t)(uint32_t)_mm256_movemask_epi8(highNewLines) << 32;
+        __m256i lowSeparators = _mm256_or_si256(lowNewLines, findSeparators(
+                low, compared, numOfCompared, lowBitmap, highBitmap));
+        __m256i highSeparators = _mm256_or_si256(highNewLines, findSeparators(
+                high, compared, numOfCompared, lowBitmap, highBitmap));
+        uint64_t separators = (uint32_t)_mm256_movemask_epi8(lowSeparators) |
+                (uint64_t)(uint32_t)_mm256_movemask_epi8(highSeparators) << 32;
+        countBlock(counts, newLines, separators);
+        if(mode->metrics)
+        {
+            measureBlock(&counts->metrics, buffer + i, newLines, separators, banks);
+        }
+    }
+    if(mode->metrics)
+    {
+        addBanks(&counts->metrics, banks);
+    }
+    countScalar(mode, counts, buffer + i, length - i);
+}
+#endif
+
+/**
+ * @brief checks if the code point is a unicode white space, which separates words in utf-8
+ * mode.
+ * @param codePoint the code point
+ * @return TRUE\FALSE
+ */
+static int isUnicodeSpace(uint32_t codePoint)
+{
+    return (codePoint >= 0x09 && codePoint <= 0x0D) || codePoint == SPACE ||
+           codePoint == 0x85 || codePoint == 0xA0 || codePoint == 0x1680 ||
+           (codePoint >= 0x2000 && codePoint <= 0x200A) || codePoint == 0x2028 ||
+           codePoint == 0x2029 || codePoint == 0x202F || codePoint == 0x205F ||
+           codePoint == 0x3000;
+}
+
+/**
+ * @brief checks if the byte is a utf-8 continuation byte.
+ * @param c the byte
+ * @return TRUE\FALSE
+ */
+static inline int isContinuation(unsigned char c)
+{
+    return (c & CONTINUATION_MASK) == CONTINUATION;
+}
+
+/**
+ * @brief Gets the length of the utf-8 sequence the byte is the lead of.
+ * @param lead the byte
+ * @return the length in bytes, 1 for ascii and for bytes that can't lead a sequence
+ */
+static int sequenceLength(unsigned char lead)
+{
+    if(lead < 0xC2 || lead > 0xF4)
+    {
+        return 1;
+    }
+    return lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : 2;
+}
+
+/**
+ * @brief checks if the bytes start with a unicode white space. the multi byte spaces all
+ * start with 0xC2, 0xE1, 0xE2 or 0xE3.
+ * @param bytes the bytes
+ * @param available the amount of bytes that can be read
+ * @return the length in bytes of the white space, 0 if the bytes don't start with one
+ */
+static int utf8SeparatorLength(const unsigned char *bytes, size_t available)
+{
+    if(bytes[0] < CONTINUATION)
+    {
+        return isUnicodeSpace(bytes[0]);
+    }
+    if(bytes[0] == 0xC2 && available >= 2 && isContinuation(bytes[1]))
+    {
+        return isUnicodeSpace(((bytes[0] & 0x1Fu) << 6) | (bytes[1] & 0x3Fu)) ? 2 : 0;
+    }
+    if(bytes[0] >= 0xE1 && bytes[0] <= 0xE3 && available >= 3 && isContinuation(bytes[1]) &&
+       isContinuation(bytes[2]))
+    {
+        return isUnicodeSpace(((bytes[0] & 0x0Fu) << 12) | ((bytes[1] & 0x3Fu) << 6) |
+                              (bytes[2] & 0x3Fu)) ? 3 : 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief Runs the startedWord state machine over one decoded code point.
+ * @param counts the running totals
+ * @param separator whether the code point is a white space
+ */
+static inline void countCodePoint(Counts *counts, int separator)
+{
+    if(separator)
+    {
+        counts->startedWord = FALSE;
+    }
+    else
+    {
+        if(!counts->startedWord)
+        {
+            counts->words ++;
+        }
+        counts->startedWord = TRUE;
+    }
+}
+
+/**
+ * @brief Ends the pending utf-8 sequence before all its continuation bytes arrived, it is
+ * counted as a word char.
+ * @param counts the running totals
+ */
+static void cutSequence(Counts *counts)
+{
+    counts->invalid = TRUE;
+    if(!counts->pendingCounted)
+    {
+        countCodePoint(counts, FALSE);
+    }
+    counts->pendingBytes = 0;
+}
+
+/**
+ * @brief Starts decoding a multi byte utf-8 sequence.
+ * @param counts the running totals
+ * @param lead the first byte of the sequence, 0xC2 to 0xF4
+ */
+static void startSequence(Counts *counts, unsigned char lead)
+{
+    counts->pendingCounted = FALSE;
+    counts->lowerBound = 0x80;
+    counts->upperBound = 0xBF;
+    if(lead < 0xE0)
+    {
+        counts->pendingBytes = 1;
+        counts->codePoint = lead & 0x1Fu;
+    }
+    else if(lead < 0xF0)
+    {
+        counts->pendingBytes = 2;
+        counts->codePoint = lead & 0x0Fu;
+        // no overlong sequences and no surrogates
+        counts->lowerBound = lead == 0xE0 ? 0xA0 : 0x80;
+        counts->upperBound = lead == 0xED ? 0x9F : 0xBF;
+    }
+    else
+    {
+        counts->pendingBytes = 3;
+        counts->codePoint = lead & 0x07u;
+        // no overlong sequences and nothing above U+10FFFF
+        counts->lowerBound = lead == 0xF0 ? 0x90 : 0x80;
+        counts->upperBound = lead == 0xF4 ? 0x8F : 0xBF;
+    }
+}
+
+/**
+ * @brief Decodes a single utf-8 byte. every byte that isn't a continuation byte is a
+ * character, even when it doesn't start a valid sequence, so the totals match the vector
+ * kernel's count of the non continuation bytes.
+ * @param counts the running totals
+ * @param c the byte
+ */
+static inline void countUtf8Byte(Counts *counts, unsigned char c)
+{
+    if(counts->pendingBytes > 0)
+    {
+        if(counts->lowerBound <= c && c <= counts->upperBound)
+        {
+            counts->codePoint = (counts->codePoint << 6) | (c & 0x3Fu);
+            counts->lowerBound = 0x80;
+            counts->upperBound = 0xBF;
+            if(--counts->pendingBytes == 0 && !counts->pendingCounted)
+            {
+                countCodePoint(counts, isUnicodeSpace(counts->codePoint));
+            }
+            return;
+        }
+        cutSequence(counts);
+    }
+    if(c < CONTINUATION)
+    {
+        counts->characters ++;
+        if(c == NL)
+        {
+            counts->rows ++;
+        }
+        countCodePoint(counts, isUnicodeSpace(c));
+        return;
+    }
+    if(isContinuation(c))
+    {
+        // a continuation byte without a lead isn't a character, it continues whatever is
+        // before it
+        counts->invalid = TRUE;
+        counts->startedWord = TRUE;
+        return;
+    }
+    counts->characters ++;
+    if(c < 0xC2 || c > 0xF4)
+    {
+        // overlong two byte leads and leads of code points above U+10FFFF
+        counts->invalid = TRUE;
+        countCodePoint(counts, FALSE);
+        return;
+    }
+    startSequence(counts, c);
+}
+
+/**
+ * @brief Counts the buffer as utf-8 one byte at a time, used around the vector kernel and on
+ * machines without it.
+ * @param mode how the input is counted
+ * @param counts the running totals
+ * @param buffer the bytes to count
+ * @param length the amount of bytes in the buffer
+ */
+static void countUtf8Scalar(const CountMode *mode, Counts *counts, const unsigned char *buffer,
+                            size_t length)
+{
+    (void)mode;
+    for (size_t i = 0; i < length; i++)
+    {
+        countUtf8Byte(counts, buffer[i]);
+    }
+}
+
+/**
+ * @brief Hands a sequence that started in the last block of the vector kernel and runs past
+ * it to the scalar decoder. the kernel already counted the sequence, the decoder only has to
+ * check its remaining continuation bytes.
+ * @param counts the running totals
+ * @param buffer the bytes that were counted
+ * @param end the end of the last block, at least UTF8_LOOKAHEAD bytes into the buffer
+ */
+static void resumeSequence(Counts *counts, const unsigned char *buffer, size_t end)
+{
+    for (int back = 1; back <= UTF8_LOOKAHEAD; back++)
+    {
+        unsigned char lead = buffer[end - back];
+        if(isContinuation(lead))
+        {
+            continue;
+        }
+        if(sequenceLength(lead) > back)
+        {
+            startSequence(counts, lead);
+            counts->pendingCounted = TRUE;
+            for (int i = back - 1; i > 0 && counts->pendingBytes > 0; i--)
+            {
+                countUtf8Byte(counts, buffer[end - i]);
+            }
+        }
+        return;
+    }
+}
+
+/**
+ * @brief Ends the count, a utf-8 sequence that was cut by the end of the input is counted as
+ * a word char.
+ * @param counts the running totals
+ */
+static void finishCounts(Counts *counts)
+{
+    if(counts->pendingBytes > 0)
+    {
+        cutSequence(counts);
+    }
+}
+
+#ifdef X86_SIMD
+/**
+ * @brief Finds the invalid utf-8 in 32 bytes with the lookup algorithm of Keiser and Lemire,
+ * three nibble lookups classify every pair of adjacent bytes.
+ * @param input the bytes
+ * @param previous the 32 bytes before them
+ * @return a vector that isn't zero if the bytes, or a sequence that runs into them, are
+ *         invalid
+ */
+__attribute__((target("avx2")))
+static inline __m256i utf8Errors(__m256i input, __m256i previous)
+{
+    // the bit of each error, a pair of bytes is invalid if a bit is set in all three lookups
+    const char tooShort = 1 << 0;
+    const char tooLong = 1 << 1;
+    const char overlong3 = 1 << 2;
+    const char tooLarge = 1 << 3;
+    const char surrogate = 1 << 4;
+    const char overlong2 = 1 << 5;
+    const char tooLarge1000 = 1 << 6;
+    const char overlong4 = 1 << 6;
+    const char twoConts = (char)(1 << 7);
+    const char carry = tooShort | tooLong | twoConts;
+    const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+    __m256i shifted = _mm256_permute2x128_si256(previous, input, 0x21);
+    __m256i previous1 = _mm256_alignr_epi8(input, shifted, 16 - 1);
+    __m256i previous2 = _mm256_alignr_epi8(input, shifted, 16 - 2);
+    __m256i previous3 = _mm256_alignr_epi8(input, shifted, 16 - 3);
+    __m256i byte1High = _mm256_shuffle_epi8(_mm256_setr_epi8(
+            tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong,
+            twoConts, twoConts, twoConts, twoConts,
+            tooShort | overlong2, tooShort, tooShort | overlong3 | surrogate,
+            tooShort | tooLarge | tooLarge1000 | overlong4,
+            tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong,
+            twoConts, twoConts, twoConts, twoConts,
+            tooShort | overlong2, tooShort, tooShort | overlong3 | surrogate,
+            tooShort | tooLarge | tooLarge1000 | overlong4),
+            _mm256_and_si256(_mm256_srli_epi16(previous1, 4), lowNibble));
+    __m256i byte1Low = _mm256_shuffle_epi8(_mm256_setr_epi8(
+            carry | overlong3 | overlong2 | overlong4, carry | overlong2, carry, carry,
+            carry | tooLarge, carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000 | surrogate, carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000,
+            carry | overlong3 | overlong2 | overlong4, carry | overlong2, carry, carry,
+            carry | tooLarge, carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000 | surrogate, carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000),
+            _mm256_and_si256(previous1, lowNibble));
+    __m256i byte2High = _mm256_shuffle_epi8(_mm256_setr_epi8(
+            tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort,
+            tooLong | overlong2 | twoConts | overlong3 | tooLarge1000 | overlong4,
+            tooLong | overlong2 | twoConts | overlong3 | tooLarge,
+            tooLong | overlong2 | twoConts | surrogate | tooLarge,
+            tooLong | overlong2 | twoConts | surrogate | tooLarge,
+            tooShort, tooShort, tooShort, tooShort,
+            tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort,
+            tooLong | overlong2 | twoConts | overlong3 | tooLarge1000 | overlong4,
+            tooLong | overlong2 | twoConts | overlong3 | tooLarge,
+            tooLong | overlong2 | twoConts | surrogate | tooLarge,
+            tooLong | overlong2 | twoConts | surrogate | tooLarge,
+            tooShort, tooShort, tooShort, tooShort),
+            _mm256_and_si256(_mm256_srli_epi16(input, 4), lowNibble));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(byte1High, byte1Low), byte2High);
+    // the third and fourth bytes of a sequence are the only continuations that the pair
+    // lookups allow after another continuation
+    __m256i thirdByte = _mm256_subs_epu8(previous2, _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    __m256i fourthByte = _mm256_subs_epu8(previous3, _mm256_set1_epi8((char)(0xF0 - 0x80)));
+    __m256i mustContinue = _mm256_and_si256(_mm256_or_si256(thirdByte, fourthByte),
+                                            _mm256_set1_epi8((char)0x80));
+    return _mm256_xor_si256(mustContinue, special);
+}
+
+/**
+ * @brief Makes a mask with bit i set if byte i of the 64 bytes matches.
+ * @param low the first 32 bytes compared
+ * @param high the last 32 bytes compared
+ * @return the mask
+ */
+__attribute__((target("avx2")))
+static inline uint64_t toMask(__m256i low, __m256i high)
+{
+    return (uint32_t)_mm256_movemask_epi8(low) |
+           (uint64_t)(uint32_t)_mm256_movemask_epi8(high) << 32;
+}
+
+/**
+ * @brief Makes a mask of the bytes in the range [lowest, lowest + span].
+ * @param bytes the bytes
+ * @param lowest the lowest byte in the range
+ * @param span the size of the range minus one
+ * @return a vector with 0xFF at the bytes in the range
+ */
+__attribute__((target("avx2")))
+static inline __m256i inRange(__m256i bytes, char lowest, char span)
+{
+    __m256i offset = _mm256_sub_epi8(bytes, _mm256_set1_epi8(lowest));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(span)), offset);
+}
+
+/**
+ * @brief Counts the buffer as utf-8 64 bytes at a time with AVX2, validating it on the way.
+ * characters are the bytes that aren't continuation bytes, words start at the leads of
+ * code points that aren't white spaces after ones that are. the multi byte white spaces are
+ * rare, their leads are found by a compare and decoded one by one.
+ * @param mode how the input is counted
+ * @param counts the running totals
+ * @param buffer the bytes to count
+ * @param length the amount of bytes in the buffer
+ */
+__attribute__((target("avx2,popcnt")))
+static void countUtf8Avx2(const CountMode *mode, Counts *counts, const unsigned char *buffer,
+                          size_t length)
+{
+    size_t i = 0;
+    // the vector loop starts at the beginning of a sequence
+    for (; i < length && counts->pendingBytes > 0; i++)
+    {
+        countUtf8Byte(counts, buffer[i]);
+    }
+    if(length - i >= BLOCK_SIZE + UTF8_LOOKAHEAD)
+    {
+        const __m256i newLine = _mm256_set1_epi8(NL);
+        const __m256i space = _mm256_set1_epi8(SPACE);
+        // saturating subtraction of the last bytes leaves them non zero if a sequence they
+        // start is longer than what is left of the block
+        const __m256i incompleteLimit = _mm256_setr_epi8(
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+        __m256i previous = _mm256_setzero_si256();
+        __m256i previousIncomplete = _mm256_setzero_si256();
+        __m256i errors = _mm256_setzero_si256();
+        // white space bytes of a sequence that started in the previous block
+        uint64_t separatorCarry = 0;
+        for (; i + BLOCK_SIZE + UTF8_LOOKAHEAD <= length; i += BLOCK_SIZE)
+        {
+            __m256i low = _mm256_loadu_si256((const __m256i *)(buffer + i));
+            __m256i high = _mm256_loadu_si256((const __m256i *)(buffer + i + 32));
+            uint64_t newLines = toMask(_mm256_cmpeq_epi8(low, newLine),
+                                       _mm256_cmpeq_epi8(high, newLine));
+            uint64_t separators = separatorCarry |
+                    toMask(_mm256_or_si256(_mm256_cmpeq_epi8(low, space), inRange(low, 0x09, 4)),
+                           _mm256_or_si256(_mm256_cmpeq_epi8(high, space), inRange(high, 0x09, 4)));
+            separatorCarry = 0;
+            uint64_t leads = ~(uint64_t)0;
+            if(_mm256_movemask_epi8(_mm256_or_si256(low, high)) == 0)
+            {
+                // plain ascii, only a sequence cut at the end of the previous block is invalid
+                errors = _mm256_or_si256(errors, previousIncomplete);
+                previousIncomplete = _mm256_setzero_si256();
+            }
+            else
+            {
+                errors = _mm256_or_si256(errors, _mm256_or_si256(utf8Errors(low, previous),
+                                                                 utf8Errors(high, low)));
+                previousIncomplete = _mm256_subs_epu8(high, incompleteLimit);
+                // continuation bytes are 0x80 to 0xBF, the lowest signed bytes
+                leads = ~toMask(_mm256_cmpgt_epi8(_mm256_set1_epi8((char)0xC0), low),
+                                _mm256_cmpgt_epi8(_mm256_set1_epi8((char)0xC0), high));
+                uint64_t candidates = toMask(
+                        _mm256_or_si256(_mm256_cmpeq_epi8(low, _mm256_set1_epi8((char)0xC2)),
+                                        inRange(low, (char)0xE1, 2)),
+                        _mm256_or_si256(_mm256_cmpeq_epi8(high, _mm256_set1_epi8((char)0xC2)),
+                                        inRange(high, (char)0xE1, 2)));
+                while(candidates != 0)
+                {
+                    int j = __builtin_ctzll(candidates);
+                    int spaceLength = utf8SeparatorLength(buffer + i + j, length - i - j);
+                    uint64_t spaceBytes = ((uint64_t)1 << spaceLength) - 1;
+                    separators |= spaceBytes << j;
+                    if(j + spaceLength > BLOCK_SIZE)
+                    {
+                        separatorCarry |= spaceBytes >> (BLOCK_SIZE - j);
+                    }
+                    candidates &= candidates - 1;
+                }
+            }
+            previous = high;
+            uint64_t wordChars = ~separators;
+            uint64_t starts = wordChars & leads &
+                              ~((wordChars << 1) | (uint64_t)counts->startedWord);
+            counts->words += (uint64_t)__builtin_popcountll(starts);
+            counts->rows += (uint64_t)__builtin_popcountll(newLines);
+            counts->characters += (uint64_t)__builtin_popcountll(leads);
+            counts->startedWord = (int)(wordChars >> (BLOCK_SIZE - 1));
+        }
+        if(!_mm256_testz_si256(errors, errors))
+        {
+            counts->invalid = TRUE;
+        }
+        resumeSequence(counts, buffer, i);
+    }
+    countUtf8Scalar(mode, counts, buffer + i, length - i);
+}
+#endif
+
+/**
+ * @brief Picks the fastest kernel the running cpu supports.
+ * @param mode how the input is counted
+ * @return pointer to the counting kernel
+ */
+static CountKernel chooseKernel(const CountMode *mode)
+{
+#ifdef X86_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return mode->utf8 ? countUtf8Avx2 : countAvx2;
+    }
+    if(__builtin_cpu_supports("sse2") && !mode->utf8 &&
+       mode->numOfSeparators <= MAX_COMPARED_SEPARATORS)
+    {
+        return countSse2;
+    }
+#endif
+    return mode->utf8 ? countUtf8Scalar : countScalar;
+}
+
+/**
+ * @brief Sets the bytes that separate words in the byte mode.
+ * @param mode the mode
+ * @param isSeparator TRUE for every byte that separates words
+ */
+static void setSeparators(CountMode *mode, const unsigned char *isSeparator)
+{
+    mode->numOfSeparators = 0;
+    memset(mode->lowBitmap, 0, sizeof(mode->lowBitmap));
+    memset(mode->highBitmap, 0, sizeof(mode->highBitmap));
+    for (int c = 0; c < NUM_OF_BYTES; c++)
+    {
+        mode->classes[c] = c == NL ? NEW_LINE_CLASS : isSeparator[c] ? SEPARATOR_CLASS : WORD_CLASS;
+        if(mode->classes[c] == SEPARATOR_CLASS)
+        {
+            mode->separatorList[mode->numOfSeparators++] = (unsigned char)c;
+            unsigned char *bitmap = c < 0x80 ? mode->lowBitmap : mode->highBitmap;
+            bitmap[c & 0x0F] |= (unsigned char)(1 << ((c >> 4) & 7));
+        }
+    }
+}
+
+/**
+ * @brief checks if the buffer begins with a word char, or in utf-8 mode with a code point
+ * that isn't a white space. a continuation byte without a lead doesn't begin a word, like in
+ * countUtf8Byte it continues whatever is before it.
+ * @param mode how the input is counted
+ * @param buffer the bytes, at least one
+ * @param length the amount of bytes in the buffer
+ * @return TRUE\FALSE
+ */
+static int isLeadingWord(const CountMode *mode, const unsigned char *buffer, size_t length)
+{
+    if(mode->utf8)
+    {
+        return !isContinuation(buffer[0]) && utf8SeparatorLength(buffer, length) == 0;
+    }
+    return mode->classes[buffer[0]] == WORD_CLASS;
+}
+
+/**
+ * @brief Adds the metrics of a chunk to the metrics of everything that came before it.
+ * @param total the metrics of the input up to the chunk
+ * @param chunk the metrics of the chunk
+ */
+static void mergeMetrics(Metrics *total, const Metrics *chunk)
+{
+    for (int c = 0; c < NUM_OF_BYTES; c++)
+    {
+        total->histogram[c] += chunk->histogram[c];
+    }
+    total->wordBytes += chunk->wordBytes;
+    if(!chunk->endedFirstLine)
+    {
+        total->currentLine += chunk->currentLine;
+        return;
+    }
+    // the line running across the boundary ends with the first line of the chunk
+    uint64_t joinedLine = total->currentLine + chunk->firstLine;
+    if(!total->endedFirstLine)
+    {
+        total->firstLine = joinedLine;
+        total->endedFirstLine = TRUE;
+    }
+    if(joinedLine > total->longestLine)
+    {
+        total->longestLine = joinedLine;
+    }
+    if(chunk->longestLine > total->longestLine)
+    {
+        total->longestLine = chunk->longestLine;
+    }
+    total->currentLine = chunk->currentLine;
+}
+
+/**
+ * @brief Adds the counts of a chunk to the totals of everything that came before it.
+ * @param total the totals of the input up to the chunk
+ * @param chunk the counts of the chunk, which were started with startedWord FALSE
+ * @param leadingWord whether the chunk begins with a word char
+ */
+static void mergeCounts(Counts *total, const Counts *chunk, int leadingWord)
+{
+    total->words += chunk->words;
+    // a word running across the boundary was counted as started by the chunk too
+    if(total->startedWord && leadingWord)
+    {
+        total->words --;
+    }
+    total->rows += chunk->rows;
+    total->characters += chunk->characters;
+    total->invalid |= chunk->invalid;
+    mergeMetrics(&total->metrics, &chunk->metrics);
+    // a chunk of continuation bytes alone has no characters but still continues a word
+    if(chunk->characters > 0 || chunk->startedWord)
+    {
+        // the word and utf-8 decoding state are the chunk's
+        total->startedWord = chunk->startedWord;
+        total->codePoint = chunk->codePoint;
+        total->pendingBytes = chunk->pendingBytes;
+        total->lowerBound = chunk->lowerBound;
+        total->upperBound = chunk->upperBound;
+        total->pendingCounted = chunk->pendingCounted;
+    }
+}
+
+/**
+ * @brief Copies the word into the arena of the table.
+ * @param table the word table
+ * @param word the bytes of the word
+ * @param length the length of the word
+ * @return the copy, NULL if the memory ran out
+ */
+static const unsigned char *copyToArena(WordTable *table, const unsigned char *word,
+                                        size_t length)
+{
+    ArenaBlock *block = table->arena;
+    if(block == NULL || block->size - block->used < length)
+    {
+        size_t size = length > ARENA_BLOCK_SIZE ? length : ARENA_BLOCK_SIZE;
+        block = malloc(sizeof(ArenaBlock) + size);
+        if(block == NULL)
+        {
+            return NULL;
+        }
+        block->next = table->arena;
+        block->size = size;
+        block->used = 0;
+        table->arena = block;
+    }
+    unsigned char *copy = block->bytes + block->used;
+    memcpy(copy, word, length);
+    block->used += length;
+    return copy;
+}
+
+/**
+ * @brief Doubles the capacity of the table, the words themselves stay in the arena.
+ * @param table the word table
+ * @return TRUE if the table grew, FALSE if the memory ran out
+ */
+static int growWordTable(WordTable *table)
+{
+    size_t capacity = table->capacity * 2;
+    WordEntry *entries = calloc(capacity, sizeof(WordEntry));
+    if(entries == NULL)
+    {
+        return FALSE;
+    }
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        if(table->entries[i].word != NULL)
+        {
+            size_t slot = table->entries[i].hash & (capacity - 1);
+            while(entries[slot].word != NULL)
+            {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            entries[slot] = table->entries[i];
+        }
+    }
+    free(table->entries);
+    table->entries = entries;
+    table->capacity = capacity;
+    return TRUE;
+}
+
+/**
+ * @brief Adds an occurrence of the word to the table.
+ * @param table the word table
+ * @param word the bytes of the word
+ * @param length the length of the word, at least 1
+ * @return TRUE if the word was added, FALSE if the memory ran out
+ */
+static int addWord(WordTable *table, const unsigned char *word, size_t length)
+{
+    uint64_t hash = FNV_OFFSET;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ word[i]) * FNV_PRIME;
+    }
+    size_t slot = hash & (table->capacity - 1);
+    while(table->entries[slot].word != NULL)
+    {
+        WordEntry *entry = &table->entries[slot];
+        if(entry->hash == hash && entry->length == length &&
+           memcmp(entry->word, word, length) == 0)
+        {
+            entry->count ++;
+            return TRUE;
+        }
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+    const unsigned char *copy = copyToArena(table, word, length);
+    if(copy == NULL)
+    {
+        return FALSE;
+    }
+    table->entries[slot] = (WordEntry){copy, length, hash, 1};
+    table->numOfWords ++;
+    if(table->numOfWords * 2 > table->capacity)
+    {
+        return growWordTable(table);
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Appends the start of a word that continues in the next buffer to the pending word.
+ * @param table the word table
+ * @param bytes the bytes of the word in this buffer
+ * @param length the amount of bytes
+ * @return TRUE if the bytes were appended, FALSE if the memory ran out
+ */
+static int appendPending(WordTable *table, const unsigned char *bytes, size_t length)
+{
+    if(table->pendingLength + length > table->pendingCapacity)
+    {
+        size_t capacity = (table->pendingLength + length) * 2;
+        unsigned char *pending = realloc(table->pending, capacity);
+        if(pending == NULL)
+        {
+            return FALSE;
+        }
+        table->pending = pending;
+        table->pendingCapacity = capacity;
+    }
+    memcpy(table->pending + table->pendingLength, bytes, length);
+    table->pendingLength += length;
+    return TRUE;
+}
+
+/**
+ * @brief Adds the words of the buffer to the table of the mode, splitting them by the same
+ * byte classes the counts use. a word at the end of the buffer is kept pending until the
+ * next buffer or finishWords.
+ * @param mode how the input is counted
+ * @param buffer the bytes to count
+ * @param length the amount of bytes in the buffer
+ */
+static void addWords(const CountMode *mode, const unsigned char *buffer, size_t length)
+{
+    WordTable *table = mode->wordTable;
+    size_t i = 0;
+    while(i < length && !table->outOfMemory)
+    {
+        size_t start = i;
+        while(i < length && mode->classes[buffer[i]] == WORD_CLASS)
+        {
+            i++;
+        }
+        if(i == length)
+        {
+            table->outOfMemory = !appendPending(table, buffer + start, i - start);
+            return;
+        }
+        // only a word cut by the end of the previous buffer is copied before it's looked up
+        if(table->pendingLength > 0)
+        {
+            table->outOfMemory = !appendPending(table, buffer + start, i - start) ||
+                                 !addWord(table, table->pending, table->pendingLength);
+            table->pendingLength = 0;
+        }
+        else if(i > start)
+        {
+            table->outOfMemory = !addWord(table, buffer + start, i - start);
+        }
+        i++;
+    }
+}
+
+/**
+ * @brief Adds the word the input ended with to the table.
+ * @param table the word table
+ */
+static void finishWords(WordTable *table)
+{
+    if(table->pendingLength > 0 && !table->outOfMemory)
+    {
+        table->outOfMemory = !addWord(table, table->pending, table->pendingLength);
+    }
+    table->pendingLength = 0;
+}
+
+/**
+ * @brief Orders the words from the most frequent, words as frequent are ordered by their
+ * bytes.
+ * @param first pointer to a pointer to the first WordEntry
+ * @param second pointer to a pointer to the second WordEntry
+ * @return negative if the first word comes before the second, positive if after
+ */
+static int compareWords(const void *first, const void *second)
+{
+    const WordEntry *a = *(const WordEntry *const *)first;
+    const WordEntry *b = *(const WordEntry *const *)second;
+    if(a->count != b->count)
+    {
+        return a->count > b->count ? -1 : 1;
+    }
+    size_t length = a->length < b->length ? a->length : b->length;
+    int order = memcmp(a->word, b->word, length);
+    if(order != 0)
+    {
+        return order;
+    }
+    return a->length < b->length ? -1 : a->length > b->length ? 1 : 0;
+}
+
+/**
+ * @brief Moves the heap's root down until both its children come after it in the
+ * compareWords order, so the root stays the word that comes last.
+ * @param heap the heap
+ * @param size the amount of words in the heap
+ * @param i the index of the word to move down
+ */
+static void siftDown(const WordEntry **heap, size_t size, size_t i)
+{
+    while(TRUE)
+    {
+        size_t last = i;
+        for (size_t child = 2 * i + 1; child <= 2 * i + 2 && child < size; child++)
+        {
+            if(compareWords(&heap[child], &heap[last]) > 0)
+            {
+                last = child;
+            }
+        }
+        if(last == i)
+        {
+            return;
+        }
+        const WordEntry *swapped = heap[i];
+        heap[i] = heap[last];
+        heap[last] = swapped;
+        i = last;
+    }
+}
+
+/**
+ * @brief Empties the word table, keeping its slots for the next input.
+ * @param table the word table
+ */
+static void clearWordTable(WordTable *table)
+{
+    while(table->arena != NULL)
+    {
+        ArenaBlock *next = table->arena->next;
+        free(table->arena);
+        table->arena = next;
+    }
+    memset(table->entries, 0, sizeof(WordEntry) * table->capacity);
+    table->numOfWords = 0;
+    table->pendingLength = 0;
+    table->outOfMemory = FALSE;
+}
+
+/**
+ * @brief Frees the table, its arena and its pending word.
+ * @param table the word table
+ */
+static void freeWordTable(WordTable *table)
+{
+    clearWordTable(table);
+    free(table->entries);
+    free(table->pending);
+}
+
+/**
+ * @brief Counts the buffer by the calling thread alone, adding its words to the table of the
+ * mode when there is one.
+ * @param mode how the input is counted
+ * @param counts the running totals
+ * @param buffer the bytes to count
+ * @param length the amount of bytes in the buffer
+ */
+static void countSerial(const CountMode *mode, Counts *counts, const unsigned char *buffer,
+                        size_t length)
+{
+    mode->kernel(mode, counts, buffer, length);
+    if(mode->wordTable != NULL)
+    {
+        addWords(mode, buffer, length);
+    }
+}
+
+/**
+ * @brief Counts a single chunk, the start routine of the counting threads.
+ * @param arg pointer to the Chunk
+ * @return NULL
+ */
+static void *countChunk(void *arg)
+{
+    Chunk *chunk = arg;
+    chunk->mode->kernel(chunk->mode, &chunk->counts, chunk->buffer, chunk->length);
+    return NULL;
+}
+
+/**
+ * @brief Splits the buffer into chunks, counts each one on its own thread and merges them
+ * in order, so the totals are identical to counting the buffer serially.
+ * @param buffer the bytes to count
+ * @param length the amount of bytes in the buffer
+ * @param threads the maximal amount of threads to use
+ * @param mode how the input is counted
+ * @param counts the running totals
+ */
+static void countParallel(const unsigned char *buffer, size_t length, int threads,
+                          const CountMode *mode, Counts *counts)
+{
+    size_t numOfChunks = length / MIN_CHUNK_SIZE;
+    if(numOfChunks > (size_t)threads)
+    {
+        numOfChunks = (size_t)threads;
+    }
+    // a utf-8 sequence cut by the previous buffer has to be finished serially, and the words
+    // are added to a single table in the order of the input
+    if(numOfChunks <= 1 || counts->pendingBytes > 0 || mode->wordTable != NULL)
+    {
+        countSerial(mode, counts, buffer, length);
+        return;
+    }
+    Chunk chunks[MAX_THREADS];
+    // chunks are multiples of the block size so only the last one has a scalar tail
+    size_t chunkSize = (length / numOfChunks) & ~(size_t)(BLOCK_SIZE - 1);
+    size_t start = 0;
+    for (size_t i = 0; i < numOfChunks; i++)
+    {
+        size_t end = (i == numOfChunks - 1) ? length : (i + 1) * chunkSize;
+        // in utf-8 mode chunks begin with a lead byte, so only the last one may end with a
+        // sequence that isn't complete
+        while(mode->utf8 && end < length && isContinuation(buffer[end]))
+        {
+            end++;
+        }
+        Chunk *chunk = &chunks[i];
+        chunk->buffer = buffer + start;
+        chunk->length = end - start;
+        chunk->mode = mode;
+        chunk->counts = (Counts){.rows = 0};
+        start = end;
+    }
+    // the first chunk is counted by the calling thread, a chunk whose thread couldn't be
+    // created is counted there as well
+    int started[MAX_THREADS] = {FALSE};
+    for (size_t i = 1; i < numOfChunks; i++)
+    {
+        started[i] = pthread_create(&chunks[i].thread, NULL, countChunk, &chunks[i]) == 0;
+    }
+    countChunk(&chunks[0]);
+    for (size_t i = 0; i < numOfChunks; i++)
+    {
+        if(started[i])
+        {
+            pthread_join(chunks[i].thread, NULL);
+        }
+        else if(i != 0)
+        {
+            countChunk(&chunks[i]);
+        }
+        if(i != numOfChunks - 1)
+        {
+            finishCounts(&chunks[i].counts);
+        }
+        // a chunk is empty when the continuation bytes before it ran to the end of the buffer
+        mergeCounts(counts, &chunks[i].counts, chunks[i].length > 0 &&
+                    isLeadingWord(mode, chunks[i].buffer, chunks[i].length));
+    }
+}
+
+/**
+ * @brief Initializes a counter at the beginning of an input.
+ * @param counter the counter
+ * @param options how the input is counted, separators, metrics and word frequencies are of
+ *        bytes and can't be used together with utf8
+ * @return TRUE if the counter was initialized, FALSE if the options contradict each other or
+ *         the memory ran out
+ */
+int initCounter(Counter *counter, const CounterOptions *options)
+{
+    counter->mode.wordTable = NULL;
+    if(options->utf8 && (options->separators != NULL || options->metrics ||
+                         options->wordFrequencies))
+    {
+        return FALSE;
+    }
+    const unsigned char space[NUM_OF_BYTES] = {[SPACE] = TRUE};
+    counter->mode.utf8 = options->utf8;
+    counter->mode.metrics = options->metrics;
+    setSeparators(&counter->mode, options->separators != NULL ? options->separators : space);
+    counter->mode.kernel = chooseKernel(&counter->mode);
+    counter->counts = (Counts){.rows = 1};
+    if(!options->wordFrequencies)
+    {
+        return TRUE;
+    }
+    WordTable *table = calloc(1, sizeof(WordTable));
+    if(table == NULL)
+    {
+        return FALSE;
+    }
+    table->entries = calloc(INITIAL_TABLE_SIZE, sizeof(WordEntry));
+    if(table->entries == NULL)
+    {
+        free(table);
+        return FALSE;
+    }
+    table->capacity = INITIAL_TABLE_SIZE;
+    counter->mode.wordTable = table;
+    return TRUE;
+}
+
+/**
+ * @brief Starts the count over, as if the counter was just initialized.
+ * @param counter the counter
+ */
+void resetCounter(Counter *counter)
+{
+    counter->counts = (Counts){.rows = 1};
+    if(counter->mode.wordTable != NULL)
+    {
+        clearWordTable(counter->mode.wordTable);
+    }
+}
+
+/**
+ * @brief Counts the next buffer of the input. the buffer is read where it is and isn't
+ * needed after the call, a word or utf-8 sequence may continue in the next buffer.
+ * @param counter the counter
+ * @param buffer the bytes of the input
+ * @param length the amount of bytes in the buffer
+ */
+void feedCounter(Counter *counter, const void *buffer, size_t length)
+{
+    countSerial(&counter->mode, &counter->counts, buffer, length);
+}
+
+/**
+ * @brief Counts the next buffer of the input like feedCounter, splitting a large buffer
+ * between threads.
+ * @param counter the counter
+ * @param buffer the bytes of the input
+ * @param length the amount of bytes in the buffer
+ * @param threads the maximal amount of threads to use, at most MAX_THREADS
+ */
+void feedCounterParallel(Counter *counter, const void *buffer, size_t length, int threads)
+{
+    countParallel(buffer, length, threads, &counter->mode, &counter->counts);
+}
+
+/**
+ * @brief Ends the input, a word or a utf-8 sequence it ended in the middle of is counted.
+ * @param counter the counter
+ * @return TRUE if the counts are complete, FALSE if the memory for the word frequencies ran
+ *         out
+ */
+int finishCounter(Counter *counter)
+{
+    finishCounts(&counter->counts);
+    WordTable *table = counter->mode.wordTable;
+    if(table == NULL)
+    {
+        return TRUE;
+    }
+    finishWords(table);
+    return !table->outOfMemory;
+}
+
+/**
+ * @brief Selects the most frequent words of a counter that keeps the word frequencies.
+ * @param counter the counter, after finishCounter
+ * @param top the maximal amount of words to select
+ * @param words will be set to the selected words, from the most frequent. words as
+ *        frequent are ordered by their bytes. should have room for top words
+ * @return the amount of selected words
+ */
+size_t selectTopWords(const Counter *counter, size_t top, const WordEntry **words)
+{
+    const WordTable *table = counter->mode.wordTable;
+    if(table == NULL)
+    {
+        return 0;
+    }
+    if(top > table->numOfWords)
+    {
+        top = table->numOfWords;
+    }
+    // words is a heap whose root is the selected word that comes last, so a word that comes
+    // before it replaces it
+    size_t size = 0;
+    for (size_t i = 0; i < table->capacity && top > 0; i++)
+    {
+        const WordEntry *entry = &table->entries[i];
+        if(entry->word == NULL)
+        {
+            continue;
+        }
+        if(size < top)
+        {
+            words[size++] = entry;
+            if(size == top)
+            {
+                for (size_t j = top / 2; j-- > 0;)
+                {
+                    siftDown(words, size, j);
+                }
+            }
+        }
+        else if(compareWords(&entry, &words[0]) < 0)
+        {
+            words[0] = entry;
+            siftDown(words, size, 0);
+        }
+    }
+    qsort(words, size, sizeof(WordEntry *), compareWords);
+    return size;
+}
+
+/**
+ * @brief The length of the longest line, the last line counts even without a new line.
+ * @param metrics the metrics of the whole input
+ * @return the length in bytes
+ */
+uint64_t longestLine(const Metrics *metrics)
+{
+    return metrics->currentLine > metrics->longestLine ? metrics->currentLine :
+           metrics->longestLine;
+}
+
+/**
+ * @brief Finds where the last complete utf-8 sequence of a buffer ends, so a sequence that
+ * is still being written can be left for later.
+ * @param buffer the end of the input, at least its last UTF8_LOOKAHEAD bytes if there are
+ *        as many
+ * @param length the amount of bytes in the buffer
+ * @return the amount of bytes up to the end of the last complete sequence
+ */
+size_t completeUtf8Length(const unsigned char *buffer, size_t length)
+{
+    size_t available = length < UTF8_LOOKAHEAD ? length : UTF8_LOOKAHEAD;
+    for (size_t back = 1; back <= available; back++)
+    {
+        unsigned char lead = buffer[length - back];
+        if(!isContinuation(lead))
+        {
+            return sequenceLength(lead) > (int)back ? length - back : length;
+        }
+    }
+    return length;
+}
+
+/**
+ * @brief Frees the memory of the counter, it has to be initialized again to be used.
+ * @param counter the counter
+ */
+void freeCounter(Counter *counter)
+{
+    if(counter->mode.wordTable != NULL)
+    {
+        freeWordTable(counter->mode.wordTable);
+        free(counter->mode.wordTable);
+        counter->mode.wordTable = NULL;
+    }
+}
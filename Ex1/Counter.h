@@ -0,0 +1,267 @@
+/**
+ * @file Counter.h
+ * @author  Vitaly Frolov vitaly.frolov@mail.huji.ac.il
+ * @version 1.0
+ * @date 1 Nov 2015
+ *
+ * @brief A library that counts the rows, words and characters of an input fed to it in
+ * buffers.
+ *
+ * @section DESCRIPTION
+ * The counter is fed the input in buffers of any size, straight from wherever the caller
+ * keeps them, and carries the state of the count from one buffer to the next.
+ * Input  : The buffers of the input, in order.
+ * Process: Counts the rows, words and characters, optionally with metrics and the frequency
+ *          of every word.
+ * Output : The counts in the Counter.
+ */
+#ifndef COUNTER_H
+#define COUNTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// -------------------------- const definitions -------------------------
+/**
+ * @def NUM_OF_BYTES 256
+ * @brief A macro that sets the amount of different bytes.
+ */
+#define NUM_OF_BYTES 256
+/**
+ * @def UTF8_LOOKAHEAD 3
+ * @brief A macro that sets the amount of bytes after a block the utf-8 kernel may read, the
+ * rest of a sequence starting at the block's last byte.
+ */
+#define UTF8_LOOKAHEAD 3
+/**
+ * @def MAX_THREADS 256
+ * @brief A macro that sets the maximal amount of counting threads.
+ */
+#define MAX_THREADS 256
+
+// ------------------------------ types -----------------------------
+/**
+ * @struct Metrics
+ * @brief The statistics that are gathered along the counts in the single pass of -m.
+ */
+typedef struct Metrics
+{
+    uint64_t histogram[NUM_OF_BYTES];
+    // the amount of bytes in words, for the average word length
+    uint64_t wordBytes;
+    uint64_t longestLine;
+    // the length of the line that didn't end yet
+    uint64_t currentLine;
+    // the length of the first line, needed to join lines that cross chunks
+    uint64_t firstLine;
+    int endedFirstLine;
+} Metrics;
+
+/**
+ * @struct Counts
+ * @brief The running totals of the count, together with the startedWord indicator so a
+ * buffer can be counted in several pieces.
+ */
+typedef struct Counts
+{
+    uint64_t rows;
+    uint64_t words;
+    uint64_t characters;
+    /* startedWord is an indicator that track whether the count is in the middle of the word
+     * or after a space or enter keys
+     */
+    int startedWord;
+    // the utf-8 sequence that is being decoded, pendingBytes continuation bytes are missing
+    uint32_t codePoint;
+    int pendingBytes;
+    // the range of the next continuation byte, narrower after some leads
+    unsigned char lowerBound;
+    unsigned char upperBound;
+    // TRUE if the vector kernel already decided whether the pending code point starts a word
+    int pendingCounted;
+    // TRUE if the input wasn't valid utf-8
+    int invalid;
+    Metrics metrics;
+} Counts;
+
+/**
+ * @struct ArenaBlock
+ * @brief A block of memory the words are copied into one after the other, freed only with
+ * the whole arena.
+ */
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+    unsigned char bytes[];
+} ArenaBlock;
+
+/**
+ * @struct WordEntry
+ * @brief A slot of the word table, empty while word is NULL.
+ */
+typedef struct WordEntry
+{
+    const unsigned char *word;
+    size_t length;
+    uint64_t hash;
+    uint64_t count;
+} WordEntry;
+
+/**
+ * @struct WordTable
+ * @brief The frequencies of the words, an open addressing hash table with linear probing
+ * whose words live in an arena.
+ */
+typedef struct WordTable
+{
+    // capacity is a power of 2 and at most half of it is used
+    WordEntry *entries;
+    size_t capacity;
+    size_t numOfWords;
+    ArenaBlock *arena;
+    // the start of a word the previous buffer ended in the middle of
+    unsigned char *pending;
+    size_t pendingLength;
+    size_t pendingCapacity;
+    // TRUE once a word couldn't be added, the frequencies aren't complete
+    int outOfMemory;
+} WordTable;
+
+typedef struct CountMode CountMode;
+
+/**
+ * A pointer to a function that counts a buffer into the given totals.
+ */
+typedef void (*CountKernel)(const CountMode *, Counts *, const unsigned char *, size_t);
+
+/**
+ * @struct CountMode
+ * @brief How the input is counted, shared by all the threads of a count.
+ */
+struct CountMode
+{
+    CountKernel kernel;
+    int utf8;
+    // whether the Metrics are gathered
+    int metrics;
+    // the ByteClass of every byte
+    unsigned char classes[NUM_OF_BYTES];
+    // the separators other than new line, compared one by one when there are few of them
+    unsigned char separatorList[NUM_OF_BYTES];
+    int numOfSeparators;
+    /* separators as nibble bitmaps, bit h of lowBitmap[l] is set if the byte 0xhl separates
+     * words, highBitmap does the same for h of 8 and up
+     */
+    unsigned char lowBitmap[16];
+    unsigned char highBitmap[16];
+    // the table the words are added to when their frequencies are kept, NULL otherwise
+    WordTable *wordTable;
+};
+
+/**
+ * @struct Counter
+ * @brief A count of an input that is fed to it one buffer after the other. the counts are
+ * complete once finishCounter is called.
+ */
+typedef struct Counter
+{
+    CountMode mode;
+    Counts counts;
+} Counter;
+
+/**
+ * @struct CounterOptions
+ * @brief How a Counter counts its input.
+ */
+typedef struct CounterOptions
+{
+    // count code points and split words at every unicode white space
+    int utf8;
+    // gather the Metrics along the counts
+    int metrics;
+    // TRUE for every byte that separates words, NULL for a space alone. new line always does
+    const unsigned char *separators;
+    // keep the frequency of every word for selectTopWords
+    int wordFrequencies;
+} CounterOptions;
+
+// ------------------------------ functions -----------------------------
+/**
+ * @brief Initializes a counter at the beginning of an input.
+ * @param counter the counter
+ * @param options how the input is counted, separators, metrics and word frequencies are of
+ *        bytes and can't be used together with utf8
+ * @return TRUE if the counter was initialized, FALSE if the options contradict each other or
+ *         the memory ran out
+ */
+int initCounter(Counter *counter, const CounterOptions *options);
+
+/**
+ * @brief Starts the count over, as if the counter was just initialized.
+ * @param counter the counter
+ */
+void resetCounter(Counter *counter);
+
+/**
+ * @brief Counts the next buffer of the input. the buffer is read where it is and isn't
+ * needed after the call, a word or utf-8 sequence may continue in the next buffer.
+ * @param counter the counter
+ * @param buffer the bytes of the input
+ * @param length the amount of bytes in the buffer
+ */
+void feedCounter(Counter *counter, const void *buffer, size_t length);
+
+/**
+ * @brief Counts the next buffer of the input like feedCounter, splitting a large buffer
+ * between threads.
+ * @param counter the counter
+ * @param buffer the bytes of the input
+ * @param length the amount of bytes in the buffer
+ * @param threads the maximal amount of threads to use, at most MAX_THREADS
+ */
+void feedCounterParallel(Counter *counter, const void *buffer, size_t length, int threads);
+
+/**
+ * @brief Ends the input, a word or a utf-8 sequence it ended in the middle of is counted.
+ * @param counter the counter
+ * @return TRUE if the counts are complete, FALSE if the memory for the word frequencies ran
+ *         out
+ */
+int finishCounter(Counter *counter);
+
+/**
+ * @brief Selects the most frequent words of a counter that keeps the word frequencies.
+ * @param counter the counter, after finishCounter
+ * @param top the maximal amount of words to select
+ * @param words will be set to the selected words, from the most frequent. words as
+ *        frequent are ordered by their bytes. should have room for top words
+ * @return the amount of selected words
+ */
+size_t selectTopWords(const Counter *counter, size_t top, const WordEntry **words);
+
+/**
+ * @brief The length of the longest line, the last line counts even without a new line.
+ * @param metrics the metrics of the whole input
+ * @return the length in bytes
+ */
+uint64_t longestLine(const Metrics *metrics);
+
+/**
+ * @brief Finds where the last complete utf-8 sequence of a buffer ends, so a sequence that
+ * is still being written can be left for later.
+ * @param buffer the end of the input, at least its last UTF8_LOOKAHEAD bytes if there are
+ *        as many
+ * @param length the amount of bytes in the buffer
+ * @return the amount of bytes up to the end of the last complete sequence
+ */
+size_t completeUtf8Length(const unsigned char *buffer, size_t length);
+
+/**
+ * @brief Frees the memory of the counter, it has to be initialized again to be used.
+ * @param counter the counter
+ */
+void freeCounter(Counter *counter);
+
+#endif // COUNTER_H
@@ -15,213 +15,1315 @@
  */
 
 // ------------------------------ includes -----------------------------
+// needed for mmap, ftruncate and sysconf under -std=c99
+#define _DEFAULT_SOURCE
 #include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "Shift.h"
 
 // -------------------------- const definitions -------------------------
 /**
- * @def LOW_CASE_LOW_BORDER
- * @brief A macro which is the letter 'a' in ASCII code.
+ * @def DECRYPT
+ * @brief A macro sets the letter 'd'.
  */
-#define LOW_CASE_LOW_BORDER 97
+#define DECRYPT 'd'
 
 /**
- * @def LOW_CASE_UPPER_BORDER
- * @brief A macro which is the letter 'z' in ASCII code.
+ * @def ENCRYPT
+ * @brief A macro sets the letter 'e'.
  */
-#define LOW_CASE_UPPER_BORDER 122
+#define ENCRYPT 'e'
 
 /**
- * @def UPPER_CASE_LOW_BORDER
- * @brief A macro which is the letter 'A' in ASCII code.
+ * @def EOS
+ * @brief A macro which sets the end of string.
  */
-#define UPPER_CASE_LOW_BORDER 65
+#define EOS '\0'
 
 /**
- * @def UPPER_CASE_UPPER_BORDER
- * @brief A macro which is the letter 'Z' in ASCII code.
+ * @def STREAM_FLAG "-s"
+ * @brief A macro that sets the flag that streams the input instead of reading a single line.
  */
-#define UPPER_CASE_UPPER_BORDER 90
+#define STREAM_FLAG "-s"
 
 /**
- * @def NUM_LOW_BORDER
- * @brief A macro which is the number '0' in ASCII code.
+ * @def BLOCK_SIZE 65536
+ * @brief A macro that sets the size of the blocks the streamed input is transformed in.
  */
-#define NUM_LOW_BORDER 48
+#define BLOCK_SIZE 65536
 
 /**
- * @def NUM_UPPER_BORDER
- * @brief A macro which is the number '9' in ASCII code.
+ * @def IN_PLACE_FLAG "-i"
+ * @brief A macro that sets the flag that encrypts\decrypts a file in place.
  */
-#define NUM_UPPER_BORDER 57
+#define IN_PLACE_FLAG "-i"
 
 /**
- * @def DECRYPT
- * @brief A macro sets the letter 'd'.
+ * @def OUTPUT_FLAG "-o"
+ * @brief A macro that sets the flag that encrypts\decrypts a file into an output file.
  */
-#define DECRYPT 'd'
+#define OUTPUT_FLAG "-o"
 
 /**
- * @def ENCRYPT
- * @brief A macro sets the letter 'e'.
+ * @def THREADS_FLAG "-j"
+ * @brief A macro that sets the flag of the amount of threads that shift a file.
  */
-#define ENCRYPT 'e'
+#define THREADS_FLAG "-j"
 
 /**
- * @def EOS
- * @brief A macro which sets the end of string.
+ * @def ENCRYPT_FLAG "-e"
+ * @brief A macro that sets the flag that encrypts by the shift after it, without prompting.
  */
-#define EOS '\0'
+#define ENCRYPT_FLAG "-e"
+
+/**
+ * @def DECRYPT_FLAG "-d"
+ * @brief A macro that sets the flag that decrypts by the shift after it, without prompting.
+ */
+#define DECRYPT_FLAG "-d"
+
+/**
+ * @def MANIFEST_FLAG "-m"
+ * @brief A macro that sets the flag of the manifest of the jobs to run, "-" for the standard
+ * input.
+ */
+#define MANIFEST_FLAG "-m"
+
+/**
+ * @def MANIFEST_SEPARATORS " \t\r\n"
+ * @brief A macro that sets the characters that separate the fields of a manifest line.
+ */
+#define MANIFEST_SEPARATORS " \t\r\n"
+
+/**
+ * @def MANIFEST_COMMENT '#'
+ * @brief A macro that sets the character that starts a comment line in a manifest.
+ */
+#define MANIFEST_COMMENT '#'
+
+/**
+ * @def BYTES_IN_MB 1048576.0
+ * @brief A macro that sets the amount of bytes in a megabyte, for the throughput.
+ */
+#define BYTES_IN_MB 1048576.0
+
+/**
+ * @def KEY_FLAG "-k"
+ * @brief A macro that sets the flag of the key that encrypts\decrypts instead of a shift.
+ */
+#define KEY_FLAG "-k"
+
+/**
+ * @def DETECT_FLAG "-a"
+ * @brief A macro that sets the flag that detects the shift of the input and decrypts by it.
+ */
+#define DETECT_FLAG "-a"
+
+/**
+ * @def DETECT_SAMPLE_SIZE 1048576
+ * @brief A macro that sets the amount of a stream the shift is detected by, buffered until
+ * the shift is known.
+ */
+#define DETECT_SAMPLE_SIZE 1048576
+
+/**
+ * @def PIPELINE_FLAG "-p"
+ * @brief A macro that sets the flag that shifts the standard input into the standard output
+ * on a reader, a shifting and a writer thread.
+ */
+#define PIPELINE_FLAG "-p"
+
+/**
+ * @def PIPELINE_BUFFERS 8
+ * @brief A macro that sets the amount of buffers that go around the pipeline, a power of 2.
+ */
+#define PIPELINE_BUFFERS 8
+
+/**
+ * @def PIPELINE_BUFFER_SIZE 262144
+ * @brief A macro that sets the size of every buffer of the pipeline.
+ */
+#define PIPELINE_BUFFER_SIZE 262144
+
+/**
+ * @def PAGE_SIZE 4096
+ * @brief A macro that sets the alignment of the buffers of the pipeline, a page.
+ */
+#define PAGE_SIZE 4096
+
+/**
+ * @def CACHE_LINE 64
+ * @brief A macro that sets the size of a cache line, the ends of a ring are kept apart by it.
+ */
+#define CACHE_LINE 64
+
+/**
+ * @def BUSY_SPINS 128
+ * @brief A macro that sets how many times a stage checks its ring before it yields the cpu.
+ */
+#define BUSY_SPINS 128
+
+/**
+ * @def YIELD_SPINS 1024
+ * @brief A macro that sets how many times a stage yields the cpu before it sleeps between
+ * the checks of its ring.
+ */
+#define YIELD_SPINS 1024
+
+/**
+ * @def SLEEP_NANOSECONDS 50000
+ * @brief A macro that sets how long a stage that waits for a while sleeps between checks.
+ */
+#define SLEEP_NANOSECONDS 50000
+
+/**
+ * @def MAX_THREADS 256
+ * @brief A macro that sets the maximal amount of shifting threads.
+ */
+#define MAX_THREADS 256
+
+/**
+ * @def CHUNK_ALIGNMENT 4096
+ * @brief A macro that sets the alignment of the chunks of a file the threads shift, a page so
+ * no two threads write the same page.
+ */
+#define CHUNK_ALIGNMENT 4096
+
+// ------------------------------ types -----------------------------
+/**
+ * @struct Transform
+ * @brief What a run does to the characters, shifts them all by the shifter or by the key
+ * shifter when it isn't NULL.
+ */
+typedef struct Transform
+{
+    const Shifter *shifter;
+    const KeyShifter *keyShifter;
+} Transform;
+
+/**
+ * @struct ShiftChunk
+ * @brief A chunk of a mapped file that a thread encrypts\decrypts.
+ */
+typedef struct ShiftChunk
+{
+    const Transform *transform;
+    // the offset of the chunk in the file
+    uint64_t position;
+    const unsigned char *source;
+    // the same as source when the file is shifted in place
+    unsigned char *target;
+    size_t length;
+} ShiftChunk;
+
+/**
+ * @struct RingEntry
+ * @brief A buffer of the pipeline that is passed from one stage to the next.
+ */
+typedef struct RingEntry
+{
+    // the index of the buffer
+    int buffer;
+    // the amount of bytes in the buffer, 0 at the end of the input and -1 after a read error
+    ssize_t length;
+} RingEntry;
+
+/**
+ * @struct SpscRing
+ * @brief A lock free ring of a single producer and a single consumer. the producer is the only
+ * one that writes tail and the consumer the only one that writes head, each on its own cache
+ * line.
+ */
+typedef struct SpscRing
+{
+    RingEntry entries[PIPELINE_BUFFERS];
+    uint64_t head __attribute__((aligned(CACHE_LINE)));
+    uint64_t tail __attribute__((aligned(CACHE_LINE)));
+} SpscRing;
+
+/**
+ * @struct Pipeline
+ * @brief The buffers of a pipelined run and the rings that pass them from the reader to the
+ * shifting thread, to the writer and back to the reader.
+ */
+typedef struct Pipeline
+{
+    unsigned char *buffers[PIPELINE_BUFFERS];
+    SpscRing read;
+    SpscRing shifted;
+    SpscRing free;
+    const Transform *transform;
+    int input;
+    // set by the writer when it couldn't write, so the reader stops
+    int stop;
+} Pipeline;
+
+/**
+ * @struct ShiftJob
+ * @brief One line of a manifest, an input to encrypt\decrypt into an output.
+ */
+typedef struct ShiftJob
+{
+    int shift;
+    int action;
+    char *inputName;
+    char *outputName;
+    uint64_t bytes;
+    double seconds;
+    int failed;
+} ShiftJob;
+
+/**
+ * @struct JobPool
+ * @brief The jobs of a manifest, handed out one at a time to a bounded amount of worker
+ * threads.
+ */
+typedef struct JobPool
+{
+    ShiftJob *jobs;
+    size_t numOfJobs;
+    // the index of the next job that wasn't taken by a worker yet
+    size_t nextJob;
+    // guards nextJob and the status lines, so they aren't mixed
+    pthread_mutex_t lock;
+} JobPool;
 
 // ------------------------------ functions -----------------------------
 
 /**
- * @brief Shifts the character that was received by the desired amount.
- * @param lowerBound The lower boundary of the characters set
- * @param upperBound The upper boundary of the characters set
- * @param shift The desired amount for the character to be shifted
- * @param c The character that needs to be shifted
- * @return The character c after it was shifted
+ * @brief Gets the desired shift from the user.
+ * @param prompts the stream the prompts are printed to
+ * @return The desired shift, -1 if the input ended before it.
  */
-char charShifter(int lowerBound, int upperBound, int shift, char c)
+int desiredShift(FILE *prompts)
 {
-    // cleanShift is needed in case the shift amount exceeds the amount of characters more than once
-    int cleanShift = shift - (shift / (upperBound - lowerBound)) * (upperBound - lowerBound);
-    if(upperBound < c + shift)
+    int shift;
+    fprintf(prompts, "Please enter the shift amount:\n");
+    int read = scanf("%d", &shift);
+    getchar();
+    // getchar is used so when pressing the Enter key it won't be collected by the next scanf
+    while(read != 1 || shift < 0 || shift > MAX_SHIFT)
     {
-        // In case the shift amount exceeds the upper boundary
-        return (lowerBound + cleanShift - ( upperBound - c + 1));
+        if(read == EOF)
+        {
+            return -1;
+        }
+        fprintf(prompts, "ERROR: Shift amount should be number between 0 to 50\n");
+        fprintf(prompts, "Please enter the shift amount:\n");
+        read = scanf("%d", &shift);
+        getchar();
+    }
+    return shift;
+}
+
+/**
+ * @brief Gets the desired action from the user encryption or decryption.
+ * @param prompts the stream the prompts are printed to
+ * @return 1 for encryption, 0 for decryption, -1 if the input ended before it.
+ */
+int desiredAction(FILE *prompts)
+{
+    fprintf(prompts, "Would you like to encrypt (e) or decrypt (d)?\n");
+    int action = getchar();
+    getchar();
+    while(action != DECRYPT && action != ENCRYPT)
+    {
+        if(action == EOF)
+        {
+            return -1;
+        }
+        fprintf(prompts, "ERROR: You should type e or d\n");
+        fprintf(prompts, "Would you like to encrypt (e) or decrypt (d)?\n");
+        action = getchar();
+        getchar();
+    }
+    if (action == ENCRYPT)
+    {
+        return 1;
     }
     else
     {
-        return c + cleanShift;
+        return 0;
     }
 }
 
 /**
- * @brief Decrypts the character that was received by the desired amount.
- * @param shift The desired amount for the character to be shifted
- * @param c The character that needs to be shifted
- * @return The character c after it was decrypted
+ * @brief Encrypts\decrypts the buffer in place by the transform.
+ * @param transform the transform
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ * @param position the position of the buffer in the input
  */
-char decrypt(int shift, char c)
+static void transformBuffer(const Transform *transform, unsigned char *buffer, size_t length,
+                            uint64_t position)
 {
-    /* Decryption is actually encryption in the other direction, so the only thing needs to be
-     * changed is the shift
-     */
-    int decryptedChar;
-    if(LOW_CASE_LOW_BORDER <= c && c <= LOW_CASE_UPPER_BORDER)
+    if(transform->keyShifter != NULL)
     {
-        decryptedChar = charShifter(LOW_CASE_LOW_BORDER, LOW_CASE_UPPER_BORDER,
-                                    LOW_CASE_UPPER_BORDER - LOW_CASE_LOW_BORDER - shift + 1, c);
+        shiftKeyBuffer(transform->keyShifter, buffer, length, position);
     }
-    else if(UPPER_CASE_LOW_BORDER <= c && c <= UPPER_CASE_UPPER_BORDER)
+    else
     {
-        decryptedChar = charShifter(UPPER_CASE_LOW_BORDER, UPPER_CASE_UPPER_BORDER,
-                                    UPPER_CASE_UPPER_BORDER - UPPER_CASE_LOW_BORDER - shift + 1, c);
+        shiftBuffer(transform->shifter, buffer, length);
     }
-    else if(NUM_LOW_BORDER <= c && c <= NUM_UPPER_BORDER)
+}
+
+/**
+ * @brief Encrypts\decrypts the input block by block and writes every block as soon as it is
+ * done, so any length of input takes the same memory.
+ * @param input the input
+ * @param output the output
+ * @param transform the transform
+ * @param bytes will be set to the amount of bytes written
+ * @return 0 if the whole input was written, 1 on a read or write error
+ */
+static int shiftStream(FILE *input, FILE *output, const Transform *transform, uint64_t *bytes)
+{
+    unsigned char *block = malloc(BLOCK_SIZE);
+    if(block == NULL)
     {
-        decryptedChar = charShifter(NUM_LOW_BORDER, NUM_UPPER_BORDER,
-                                    NUM_UPPER_BORDER - NUM_LOW_BORDER - shift + 1, c);
+        fprintf(stderr, "Out of memory\n");
+        return 1;
     }
-    else
+    size_t length;
+    int failed = 0;
+    *bytes = 0;
+    while(!failed && (length = fread(block, 1, BLOCK_SIZE, input)) > 0)
     {
-        // in case the char that was given ain't a letter or a number
-        return c;
+        transformBuffer(transform, block, length, *bytes);
+        failed = fwrite(block, 1, length, output) != length;
+        *bytes += length;
     }
-    return decryptedChar;
+    free(block);
+    return failed || ferror(input) ? 1 : 0;
 }
 
 /**
- * @brief Encrypts the character that was received by the desired amount.
- * @param shift The desired amount for the character to be shifted
- * @param c The character that needs to be shifted
- * @return The character c after it was encrypted
+ * @brief Detects the shift of the input by its first DETECT_SAMPLE_SIZE bytes and decrypts
+ * the whole input by it into the output.
+ * @param input the input
+ * @param output the output
+ * @param bytes will be set to the amount of bytes written
+ * @return 0 if the whole input was written, 1 on a read or write error
  */
-char encrypt(int shift, char c)
+static int shiftDetected(FILE *input, FILE *output, uint64_t *bytes)
 {
-    char encryptedChar;
-    if(LOW_CASE_LOW_BORDER <= c && c <= LOW_CASE_UPPER_BORDER)
+    unsigned char *sample = malloc(DETECT_SAMPLE_SIZE);
+    if(sample == NULL)
     {
-        encryptedChar = charShifter(LOW_CASE_LOW_BORDER, LOW_CASE_UPPER_BORDER, shift, c);
+        fprintf(stderr, "Out of memory\n");
+        return 1;
     }
-    else if(UPPER_CASE_LOW_BORDER <= c && c <= UPPER_CASE_UPPER_BORDER)
+    size_t length = fread(sample, 1, DETECT_SAMPLE_SIZE, input);
+    uint64_t histogram[NUM_OF_BYTES] = {0};
+    addHistogram(histogram, sample, length);
+    int shift = detectShift(histogram);
+    fprintf(stderr, "Detected shift: %d\n", shift);
+    Shifter shifter;
+    initShifter(&shifter, shift, 0);
+    Transform transform = {&shifter, NULL};
+    transformBuffer(&transform, sample, length, 0);
+    int failed = fwrite(sample, 1, length, output) != length || ferror(input);
+    free(sample);
+    uint64_t rest = 0;
+    if(!failed && length == DETECT_SAMPLE_SIZE)
     {
-        encryptedChar = charShifter(UPPER_CASE_LOW_BORDER, UPPER_CASE_UPPER_BORDER, shift, c);
+        failed = shiftStream(input, output, &transform, &rest);
     }
-    else if(NUM_LOW_BORDER <= c && c <= NUM_UPPER_BORDER)
+    *bytes = length + rest;
+    return failed;
+}
+
+/**
+ * @brief Streams the files one after the other, or the rest of the standard input when there
+ * are none.
+ * @param fileNames the names of the files
+ * @param numOfFiles the amount of files
+ * @param transform the transform, a key starts over at the start of every file. NULL to
+ *        detect the shift of every input and decrypt it by it
+ * @return 0 if every input was written, 1 otherwise
+ */
+static int shiftFiles(char *fileNames[], int numOfFiles, const Transform *transform)
+{
+    uint64_t bytes;
+    if(numOfFiles == 0)
     {
-        encryptedChar = charShifter(NUM_LOW_BORDER, NUM_UPPER_BORDER, shift, c);
+        return transform == NULL ? shiftDetected(stdin, stdout, &bytes) :
+               shiftStream(stdin, stdout, transform, &bytes);
     }
-    else
+    int failed = 0;
+    for (int i = 0; i < numOfFiles; i++)
     {
-        return c;
+        FILE *input = fopen(fileNames[i], "rb");
+        if(input == NULL)
+        {
+            fprintf(stderr, "ERROR: Couldn't open %s\n", fileNames[i]);
+            failed = 1;
+            continue;
+        }
+        if((transform == NULL ? shiftDetected(input, stdout, &bytes) :
+            shiftStream(input, stdout, transform, &bytes)) != 0)
+        {
+            fprintf(stderr, "ERROR: Couldn't shift %s\n", fileNames[i]);
+            failed = 1;
+        }
+        fclose(input);
     }
-    return encryptedChar;
+    return failed;
 }
 
 /**
- * @brief Gets the desired shift from the user.
- * @return The desired shift.
+ * @brief Encrypts\decrypts a chunk block by block, copying every block to the target first
+ * when it isn't shifted in place, the start routine of the shifting threads.
+ * @param arg pointer to the ShiftChunk
+ * @return NULL
  */
-int desiredShift()
+static void *shiftChunk(void *arg)
 {
-    int shift;
-    printf("Please enter the shift amount:\n");
-    scanf("%d", &shift);
-    getchar();
-    // getchar is used so when pressing the Enter key it won't be collected by the next scanf
-    while(shift < 0 || shift > 50)
+    ShiftChunk *chunk = arg;
+    for (size_t done = 0; done < chunk->length; done += BLOCK_SIZE)
     {
-        printf("ERROR: Shift amount should be number between 0 to 50\n");
-        printf("Please enter the shift amount:\n");
-        scanf("%d", &shift);
+        size_t length = chunk->length - done < BLOCK_SIZE ? chunk->length - done : BLOCK_SIZE;
+        if(chunk->source != chunk->target)
+        {
+            memcpy(chunk->target + done, chunk->source + done, length);
+        }
+        transformBuffer(chunk->transform, chunk->target + done, length,
+                        chunk->position + done);
     }
-    return shift;
+    return NULL;
 }
 
 /**
- * @brief Gets the desired action from the user encryption or decryption.
- * @return 1 for encryption, 0 for decryption.
+ * @brief Splits the mapping between the threads in page aligned chunks, the shift of a
+ * character depends on nothing but its position so the chunks are shifted independently.
+ * @param transform the transform
+ * @param source the mapped input
+ * @param target the mapped output, the same as source to shift in place
+ * @param size the size of the mappings
+ * @param threads the amount of threads
  */
-int desiredAction()
+static void shiftParallel(const Transform *transform, const unsigned char *source,
+                          unsigned char *target, size_t size, int threads)
 {
-    char action;
-    printf("Would you like to encrypt (e) or decrypt (d)?\n");
-    scanf("%c", &action);
-    getchar();
-    while(action != DECRYPT && action != ENCRYPT)
+    ShiftChunk chunks[MAX_THREADS];
+    pthread_t ids[MAX_THREADS];
+    size_t perThread = (size + (size_t)threads - 1) / (size_t)threads;
+    size_t chunkSize = (perThread + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT * CHUNK_ALIGNMENT;
+    int numOfChunks = 0;
+    for (size_t offset = 0; offset < size; offset += chunkSize)
     {
-        printf("ERROR: You should type e or d\n");
-        printf("Would you like to encrypt (e) or decrypt (d)?\n");
-        action = getchar();
-        getchar();
+        ShiftChunk *chunk = &chunks[numOfChunks++];
+        chunk->transform = transform;
+        chunk->position = offset;
+        chunk->source = source + offset;
+        chunk->target = target + offset;
+        chunk->length = size - offset < chunkSize ? size - offset : chunkSize;
     }
-    if (action == ENCRYPT)
+    // the chunks that no thread could be started for are shifted by this one
+    int started = 1;
+    while(started < numOfChunks &&
+          pthread_create(&ids[started], NULL, shiftChunk, &chunks[started]) == 0)
+    {
+        started++;
+    }
+    for (int i = started; i < numOfChunks; i++)
     {
+        shiftChunk(&chunks[i]);
+    }
+    if(numOfChunks > 0)
+    {
+        shiftChunk(&chunks[0]);
+    }
+    for (int i = 1; i < started; i++)
+    {
+        pthread_join(ids[i], NULL);
+    }
+}
+
+/**
+ * @brief Encrypts\decrypts a file in place, or into the output file, through shared mappings
+ * shifted by all the threads.
+ * @param fileName the name of the file
+ * @param outputName the name of the output file, NULL to shift the file in place
+ * @param threads the amount of threads
+ * @param transform the transform, NULL to detect the shift of the file and decrypt it by it
+ * @return 0 if the file was shifted, 1 otherwise
+ */
+static int shiftMapped(const char *fileName, const char *outputName, int threads,
+                       const Transform *transform)
+{
+    int input = open(fileName, outputName == NULL ? O_RDWR : O_RDONLY);
+    if(input < 0)
+    {
+        fprintf(stderr, "ERROR: Couldn't open %s\n", fileName);
+        return 1;
+    }
+    struct stat status;
+    if(fstat(input, &status) != 0 || !S_ISREG(status.st_mode))
+    {
+        fprintf(stderr, "ERROR: %s isn't a regular file\n", fileName);
+        close(input);
         return 1;
     }
+    size_t size = (size_t)status.st_size;
+    int output = input;
+    if(outputName != NULL)
+    {
+        output = open(outputName, O_RDWR | O_CREAT, status.st_mode & 0777);
+        struct stat outputStatus;
+        if(output >= 0 && fstat(output, &outputStatus) == 0 &&
+           outputStatus.st_dev == status.st_dev && outputStatus.st_ino == status.st_ino)
+        {
+            // the output is the file itself, truncating it would lose the input, so it is
+            // shifted in place instead
+            close(output);
+            close(input);
+            return shiftMapped(fileName, NULL, threads, transform);
+        }
+        // the space is reserved up front, a store into a mapped hole fails with SIGBUS
+        if(output < 0 || ftruncate(output, 0) != 0 ||
+           (size > 0 && posix_fallocate(output, 0, (off_t)size) != 0))
+        {
+            fprintf(stderr, "ERROR: Couldn't create %s\n", outputName);
+            if(output >= 0)
+            {
+                close(output);
+            }
+            close(input);
+            return 1;
+        }
+    }
+    int failed = 0;
+    if(size > 0)
+    {
+        unsigned char *target = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, output, 0);
+        unsigned char *source = target;
+        if(outputName != NULL && target != MAP_FAILED)
+        {
+            source = mmap(NULL, size, PROT_READ, MAP_SHARED, input, 0);
+        }
+        if(target == MAP_FAILED || source == MAP_FAILED)
+        {
+            fprintf(stderr, "ERROR: Couldn't map %s\n", fileName);
+            failed = 1;
+        }
+        else
+        {
+            madvise(source, size, MADV_SEQUENTIAL);
+            Shifter shifter;
+            Transform detected = {&shifter, NULL};
+            if(transform == NULL)
+            {
+                uint64_t histogram[NUM_OF_BYTES] = {0};
+                addHistogram(histogram, source, size);
+                int shift = detectShift(histogram);
+                fprintf(stderr, "Detected shift: %d\n", shift);
+                initShifter(&shifter, shift, 0);
+                transform = &detected;
+            }
+            shiftParallel(transform, source, target, size, threads);
+        }
+        if(source != target && source != MAP_FAILED)
+        {
+            munmap(source, size);
+        }
+        if(target != MAP_FAILED)
+        {
+            munmap(target, size);
+        }
+    }
+    if(outputName != NULL && close(output) != 0)
+    {
+        failed = 1;
+    }
+    close(input);
+    return failed;
+}
+
+/**
+ * @brief Waits a little for the other end of a ring, busy at first, then yielding the cpu and
+ * then sleeping, so a stage that waits for a slow pipe doesn't take a cpu from the others.
+ * @param spins the amount of times the stage has waited so far, increased
+ */
+static void waitForRing(int *spins)
+{
+    (*spins)++;
+    if(*spins < BUSY_SPINS)
+    {
+        return;
+    }
+    if(*spins < YIELD_SPINS)
+    {
+        sched_yield();
+        return;
+    }
+    struct timespec pause = {0, SLEEP_NANOSECONDS};
+    nanosleep(&pause, NULL);
+}
+
+/**
+ * @brief Adds an entry to the ring, there is always room since the ring fits all the buffers.
+ * @param ring the ring
+ * @param buffer the index of the buffer
+ * @param length the length of the buffer
+ */
+static void pushRing(SpscRing *ring, int buffer, ssize_t length)
+{
+    uint64_t tail = ring->tail;
+    RingEntry *entry = &ring->entries[tail & (PIPELINE_BUFFERS - 1)];
+    entry->buffer = buffer;
+    entry->length = length;
+    // the entry is written before the consumer can see it
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Takes the next entry of the ring, waiting for one if it is empty.
+ * @param ring the ring
+ * @return the entry
+ */
+static RingEntry popRing(SpscRing *ring)
+{
+    uint64_t head = ring->head;
+    int spins = 0;
+    while(__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == head)
+    {
+        waitForRing(&spins);
+    }
+    RingEntry entry = ring->entries[head & (PIPELINE_BUFFERS - 1)];
+    // the entry is read before the producer can reuse its place
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return entry;
+}
+
+/**
+ * @brief Reads the input into the free buffers and passes them to the shifting thread, the
+ * start routine of the reader.
+ * @param arg pointer to the Pipeline
+ * @return NULL
+ */
+static void *readStage(void *arg)
+{
+    Pipeline *pipeline = arg;
+    while(1)
+    {
+        RingEntry entry = popRing(&pipeline->free);
+        ssize_t length = 0;
+        if(!__atomic_load_n(&pipeline->stop, __ATOMIC_RELAXED))
+        {
+            do
+            {
+                length = read(pipeline->input, pipeline->buffers[entry.buffer],
+                              PIPELINE_BUFFER_SIZE);
+            } while(length < 0 && errno == EINTR);
+        }
+        pushRing(&pipeline->read, entry.buffer, length);
+        if(length <= 0)
+        {
+            return NULL;
+        }
+    }
+}
+
+/**
+ * @brief Shifts the buffers that were read and passes them to the writer, the start routine
+ * of the shifting thread.
+ * @param arg pointer to the Pipeline
+ * @return NULL
+ */
+static void *shiftStage(void *arg)
+{
+    Pipeline *pipeline = arg;
+    uint64_t position = 0;
+    while(1)
+    {
+        RingEntry entry = popRing(&pipeline->read);
+        if(entry.length > 0)
+        {
+            transformBuffer(pipeline->transform, pipeline->buffers[entry.buffer],
+                            (size_t)entry.length, position);
+            position += (uint64_t)entry.length;
+        }
+        pushRing(&pipeline->shifted, entry.buffer, entry.length);
+        if(entry.length <= 0)
+        {
+            return NULL;
+        }
+    }
+}
+
+/**
+ * @brief Writes the whole buffer to the output.
+ * @param output the file descriptor of the output
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ * @return 0 if the buffer was written, 1 on a write error
+ */
+static int writeAll(int output, const unsigned char *buffer, size_t length)
+{
+    while(length > 0)
+    {
+        ssize_t written = write(output, buffer, length);
+        if(written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(written <= 0)
+        {
+            return 1;
+        }
+        buffer += written;
+        length -= (size_t)written;
+    }
+    return 0;
+}
+
+/**
+ * @brief Encrypts\decrypts the standard input into the standard output on three threads, the
+ * reader, the shifting thread and the writer, that pass page aligned buffers to one another
+ * through lock free rings, so a slow read or write doesn't stall the other stages.
+ * @param transform the transform
+ * @return 0 if the whole input was written, 1 otherwise
+ */
+static int shiftPipelined(const Transform *transform)
+{
+    Pipeline pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.transform = transform;
+    pipeline.input = STDIN_FILENO;
+    int allocated = 0;
+    for (; allocated < PIPELINE_BUFFERS; allocated++)
+    {
+        void *buffer;
+        if(posix_memalign(&buffer, PAGE_SIZE, PIPELINE_BUFFER_SIZE) != 0)
+        {
+            break;
+        }
+        pipeline.buffers[allocated] = buffer;
+        pushRing(&pipeline.free, allocated, 0);
+    }
+    pthread_t reader, shifter;
+    int failed = allocated < PIPELINE_BUFFERS;
+    if(failed)
+    {
+        fprintf(stderr, "Out of memory\n");
+    }
+    else if(pthread_create(&reader, NULL, readStage, &pipeline) != 0)
+    {
+        fprintf(stderr, "ERROR: Couldn't start the pipeline\n");
+        failed = 1;
+    }
+    else if(pthread_create(&shifter, NULL, shiftStage, &pipeline) != 0)
+    {
+        fprintf(stderr, "ERROR: Couldn't start the pipeline\n");
+        failed = 1;
+        // the reader stops at the next free buffer, there are free buffers left
+        __atomic_store_n(&pipeline.stop, 1, __ATOMIC_RELAXED);
+        pthread_join(reader, NULL);
+    }
     else
+    {
+        int writeFailed = 0;
+        while(1)
+        {
+            RingEntry entry = popRing(&pipeline.shifted);
+            if(entry.length <= 0)
+            {
+                failed = writeFailed || entry.length < 0;
+                break;
+            }
+            if(!writeFailed && writeAll(STDOUT_FILENO, pipeline.buffers[entry.buffer],
+                                        (size_t)entry.length) != 0)
+            {
+                // the reader stops, the buffers that are on their way are passed over
+                writeFailed = 1;
+                __atomic_store_n(&pipeline.stop, 1, __ATOMIC_RELAXED);
+            }
+            pushRing(&pipeline.free, entry.buffer, 0);
+        }
+        pthread_join(reader, NULL);
+        pthread_join(shifter, NULL);
+    }
+    for (int i = 0; i < allocated; i++)
+    {
+        free(pipeline.buffers[i]);
+    }
+    return failed;
+}
+
+/**
+ * @brief The time of a monotonic clock, for measuring how long a job took.
+ * @return the time in seconds
+ */
+static double secondsNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Checks if the output of a job is its input, which opening the output would truncate.
+ * @param input the input of the job
+ * @param outputName the name of the output of the job
+ * @return 1 if the output is the input file, 0 otherwise
+ */
+static int isSameFile(FILE *input, const char *outputName)
+{
+    struct stat inputStatus;
+    struct stat outputStatus;
+    return fstat(fileno(input), &inputStatus) == 0 && stat(outputName, &outputStatus) == 0 &&
+           inputStatus.st_dev == outputStatus.st_dev && inputStatus.st_ino == outputStatus.st_ino;
+}
+
+/**
+ * @brief Encrypts\decrypts the input of the job into its output. a job whose output is its
+ * input fails, and the input is left as it was.
+ * @param job the job
+ */
+static void runJob(ShiftJob *job)
+{
+    double start = secondsNow();
+    Shifter shifter;
+    initShifter(&shifter, job->shift, job->action);
+    Transform transform = {&shifter, NULL};
+    FILE *input = fopen(job->inputName, "rb");
+    FILE *output = NULL;
+    if(input != NULL && isSameFile(input, job->outputName))
+    {
+        fprintf(stderr, "ERROR: %s is the input of its job\n", job->outputName);
+    }
+    else if(input != NULL)
+    {
+        output = fopen(job->outputName, "wb");
+    }
+    job->failed = output == NULL || shiftStream(input, output, &transform, &job->bytes) != 0;
+    if(output != NULL && fclose(output) != 0)
+    {
+        job->failed = 1;
+    }
+    if(input != NULL)
+    {
+        fclose(input);
+    }
+    job->seconds = secondsNow() - start;
+}
+
+/**
+ * @brief Takes the jobs of the pool one at a time until none are left, printing the status
+ * line of every job as soon as it is done, the start routine of the worker threads.
+ * @param arg pointer to the JobPool
+ * @return NULL
+ */
+static void *jobWorker(void *arg)
+{
+    JobPool *pool = arg;
+    while(1)
+    {
+        pthread_mutex_lock(&pool->lock);
+        size_t i = pool->nextJob++;
+        pthread_mutex_unlock(&pool->lock);
+        if(i >= pool->numOfJobs)
+        {
+            return NULL;
+        }
+        ShiftJob *job = &pool->jobs[i];
+        runJob(job);
+        double seconds = job->seconds > 0 ? job->seconds : 1e-9;
+        pthread_mutex_lock(&pool->lock);
+        if(job->failed)
+        {
+            printf("%s -> %s: FAILED\n", job->inputName, job->outputName);
+        }
+        else
+        {
+            printf("%s -> %s: %" PRIu64 " bytes %.3f s %.1f MB/s\n", job->inputName,
+                   job->outputName, job->bytes, job->seconds,
+                   (double)job->bytes / BYTES_IN_MB / seconds);
+        }
+        fflush(stdout);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/**
+ * @brief Parses a shift amount of 0 to MAX_SHIFT from the argument.
+ * @param arg the argument
+ * @return the shift, -1 if the argument isn't one
+ */
+static int parseShift(const char *arg)
+{
+    char *end;
+    long shift = strtol(arg, &end, 10);
+    if(*arg == '\0' || *end != '\0' || shift < 0 || shift > MAX_SHIFT)
+    {
+        return -1;
+    }
+    return (int)shift;
+}
+
+/**
+ * @brief Parses a manifest line of a shift, e or d, an input and an output into a job.
+ * @param line the line, its fields are cut in it
+ * @param job the job
+ * @return 1 if the line is a job, 0 if it is empty or a comment, -1 if it isn't valid or the
+ *         memory ran out
+ */
+static int parseJob(char *line, ShiftJob *job)
+{
+    char *rest;
+    char *fields[5];
+    int numOfFields = 0;
+    for (char *field = strtok_r(line, MANIFEST_SEPARATORS, &rest);
+         field != NULL && numOfFields < 5; field = strtok_r(NULL, MANIFEST_SEPARATORS, &rest))
+    {
+        fields[numOfFields++] = field;
+    }
+    if(numOfFields == 0 || fields[0][0] == MANIFEST_COMMENT)
+    {
+        return 0;
+    }
+    if(numOfFields != 4 || (job->shift = parseShift(fields[0])) < 0 ||
+       (strcmp(fields[1], "e") != 0 && strcmp(fields[1], "d") != 0))
+    {
+        return -1;
+    }
+    job->action = fields[1][0] == ENCRYPT;
+    job->inputName = strdup(fields[2]);
+    job->outputName = strdup(fields[3]);
+    if(job->inputName == NULL || job->outputName == NULL)
+    {
+        free(job->inputName);
+        free(job->outputName);
+        return -1;
+    }
+    // a job that fails before its input is read is summed up as nothing
+    job->bytes = 0;
+    job->seconds = 0;
+    job->failed = 0;
+    return 1;
+}
+
+/**
+ * @brief Reads the jobs of a manifest, a line of a shift, e or d, an input and an output for
+ * every job. empty lines and lines starting with # are skipped.
+ * @param manifest the manifest
+ * @param numOfJobs will be set to the amount of jobs read
+ * @return array of the jobs, NULL if a line isn't valid or the memory ran out. the array and
+ *         the names in it should be freed
+ */
+static ShiftJob *readManifest(FILE *manifest, size_t *numOfJobs)
+{
+    size_t capacity = 16;
+    ShiftJob *jobs = malloc(sizeof(ShiftJob) * capacity);
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    size_t lineNumber = 0;
+    int valid = jobs != NULL;
+    *numOfJobs = 0;
+    while(valid && getline(&line, &lineCapacity, manifest) != -1)
+    {
+        lineNumber++;
+        if(*numOfJobs == capacity)
+        {
+            capacity *= 2;
+            ShiftJob *larger = realloc(jobs, sizeof(ShiftJob) * capacity);
+            if(larger == NULL)
+            {
+                valid = 0;
+                break;
+            }
+            jobs = larger;
+        }
+        int parsed = parseJob(line, &jobs[*numOfJobs]);
+        if(parsed < 0)
+        {
+            fprintf(stderr, "ERROR: Line %zu of the manifest isn't a shift, e or d, an input "
+                    "and an output\n", lineNumber);
+            valid = 0;
+        }
+        *numOfJobs += parsed > 0;
+    }
+    free(line);
+    if(!valid && jobs != NULL)
+    {
+        for (size_t i = 0; i < *numOfJobs; i++)
+        {
+            free(jobs[i].inputName);
+            free(jobs[i].outputName);
+        }
+        free(jobs);
+        return NULL;
+    }
+    return jobs;
+}
+
+/**
+ * @brief Runs the jobs of the manifest on a pool of worker threads, prints the status line of
+ * every job as it is done and then a line of the total throughput.
+ * @param manifestName the path of the manifest, "-" for the standard input
+ * @param workers the amount of worker threads
+ * @return 0 if all the jobs were done, 1 otherwise
+ */
+static int runManifest(const char *manifestName, int workers)
+{
+    FILE *manifest = strcmp(manifestName, "-") == 0 ? stdin : fopen(manifestName, "r");
+    if(manifest == NULL)
+    {
+        fprintf(stderr, "ERROR: Couldn't open %s\n", manifestName);
+        return 1;
+    }
+    JobPool pool;
+    pool.jobs = readManifest(manifest, &pool.numOfJobs);
+    if(manifest != stdin)
+    {
+        fclose(manifest);
+    }
+    if(pool.jobs == NULL)
+    {
+        return 1;
+    }
+    double start = secondsNow();
+    pool.nextJob = 0;
+    pthread_mutex_init(&pool.lock, NULL);
+    if((size_t)workers > pool.numOfJobs)
+    {
+        workers = pool.numOfJobs > 0 ? (int)pool.numOfJobs : 1;
+    }
+    pthread_t threads[MAX_THREADS];
+    int started = 0;
+    // the calling thread is one of the workers
+    while(started < workers - 1 &&
+          pthread_create(&threads[started], NULL, jobWorker, &pool) == 0)
+    {
+        started++;
+    }
+    jobWorker(&pool);
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool.lock);
+    double seconds = secondsNow() - start;
+    if(seconds <= 0)
+    {
+        seconds = 1e-9;
+    }
+
+    uint64_t bytes = 0;
+    size_t numOfFailed = 0;
+    for (size_t i = 0; i < pool.numOfJobs; i++)
+    {
+        bytes += pool.jobs[i].bytes;
+        numOfFailed += pool.jobs[i].failed;
+        free(pool.jobs[i].inputName);
+        free(pool.jobs[i].outputName);
+    }
+    free(pool.jobs);
+    printf("Jobs:%zu failed:%zu bytes:%" PRIu64 " %.3f s %.1f MB/s\n", pool.numOfJobs,
+           numOfFailed, bytes, seconds, (double)bytes / BYTES_IN_MB / seconds);
+    return numOfFailed > 0 ? 1 : 0;
+}
+
+/**
+ * @brief Parses a positive amount of at most max from the argument.
+ * @param arg the argument
+ * @param max the largest amount allowed
+ * @return the amount, 0 if the argument isn't one
+ */
+static int parseAmount(const char *arg, int max)
+{
+    char *end;
+    long amount = strtol(arg, &end, 10);
+    if(*arg == '\0' || *end != '\0' || amount < 1 || amount > max)
     {
         return 0;
     }
+    return (int)amount;
 }
 
 /**
  * @brief The main function. the function prints the encrypted\decrypted users input.
+ * with -s the prompts go to the standard error and the files, or the rest of the standard
+ * input, are encrypted\decrypted into the standard output as they are, of any length.
+ * -i encrypts\decrypts a file in place and -o into an output file, split between -j threads,
+ * every online cpu by default. -e and -d set the shift and the action instead of the prompts.
+ * -m runs the jobs of a manifest on -j worker threads. -k shifts every character by the key
+ * character at its position instead of by a single shift. -a detects the shift the input was
+ * encrypted by and decrypts it by that shift. -p shifts the standard input into the standard
+ * output on a reader, a shifting and a writer thread, by the shift of -e or -d.
+ * @param argc amount of arguments
+ * @param argv the args, -e or -d and the shift, -k and the key or -a, -s and the files to
+ *        stream, -i or -o and the file to shift, or -m and the manifest
  * @return 0, to tell the system the execution ended without errors.
  */
-int main()
+int main(int argc, char *argv[])
 {
-    int shift, i = 0, action;
+    int shift = -1, i = 0, action = 0;
+    // -e or -d without a shift, the action of a key
+    int keyAction = 0;
+    Shifter shifter;
+    KeyShifter keyShifter;
+    const char *key = NULL;
+    int detect = 0;
+    const char *manifestName = NULL;
+    int stream = 0;
+    int pipelined = 0;
+    int inPlace = 0;
+    int threads = 0;
+    const char *outputName = NULL;
+    int numOfFiles = 0;
+    for (int arg = 1; arg < argc; arg++)
+    {
+        if(strcmp(argv[arg], STREAM_FLAG) == 0)
+        {
+            stream = 1;
+        }
+        else if((strcmp(argv[arg], ENCRYPT_FLAG) == 0 || strcmp(argv[arg], DECRYPT_FLAG) == 0) &&
+                arg + 1 < argc && shift < 0 && (shift = parseShift(argv[arg + 1])) >= 0)
+        {
+            action = strcmp(argv[arg++], ENCRYPT_FLAG) == 0;
+        }
+        else if((strcmp(argv[arg], ENCRYPT_FLAG) == 0 || strcmp(argv[arg], DECRYPT_FLAG) == 0) &&
+                !keyAction)
+        {
+            action = strcmp(argv[arg], ENCRYPT_FLAG) == 0;
+            keyAction = 1;
+        }
+        else if(strcmp(argv[arg], PIPELINE_FLAG) == 0)
+        {
+            pipelined = 1;
+        }
+        else if(strcmp(argv[arg], DETECT_FLAG) == 0)
+        {
+            detect = 1;
+        }
+        else if(strcmp(argv[arg], KEY_FLAG) == 0 && arg + 1 < argc)
+        {
+            key = argv[++arg];
+        }
+        else if(strcmp(argv[arg], MANIFEST_FLAG) == 0 && arg + 1 < argc)
+        {
+            manifestName = argv[++arg];
+        }
+        else if(strcmp(argv[arg], IN_PLACE_FLAG) == 0)
+        {
+            inPlace = 1;
+        }
+        else if(strcmp(argv[arg], OUTPUT_FLAG) == 0 && arg + 1 < argc)
+        {
+            outputName = argv[++arg];
+        }
+        else if(strcmp(argv[arg], THREADS_FLAG) == 0 && arg + 1 < argc &&
+                (threads = parseAmount(argv[arg + 1], MAX_THREADS)) != 0)
+        {
+            arg++;
+        }
+        else if(argv[arg][0] != '-')
+        {
+            // the file names are gathered at the front of argv
+            argv[numOfFiles++] = argv[arg];
+        }
+        else
+        {
+            numOfFiles = -1;
+            break;
+        }
+    }
+    int mapped = inPlace || outputName != NULL;
+    int manifest = manifestName != NULL;
+    // the pipeline reads the standard input from the start, there are no prompts before it
+    if(numOfFiles < 0 || stream + mapped + manifest + pipelined > 1 ||
+       (inPlace && outputName != NULL) || (pipelined && (shift < 0 || numOfFiles > 0)) ||
+       (mapped && numOfFiles != 1) || (shift >= 0) + (key != NULL) + detect > 1 ||
+       (keyAction && key == NULL) ||
+       (manifest && (numOfFiles > 0 || shift >= 0 || key != NULL || detect)) ||
+       (!stream && !mapped && !manifest && !pipelined && (numOfFiles > 0 || threads > 0)) ||
+       ((stream || pipelined) && threads > 0))
+    {
+        fprintf(stderr, "Wrong parameters. Usage:\n"
+                "Shift [-e shift | -d shift | -k key [-e | -d] | -a] [-s [file...]]\n"
+                "Shift [-e shift | -d shift | -k key [-e | -d] | -a] [-j threads] -i file\n"
+                "Shift [-e shift | -d shift | -k key [-e | -d] | -a] [-j threads] -o output file\n"
+                "Shift [-j threads] -m manifest\n"
+                "Shift -e shift | -d shift -p\n");
+        return 1;
+    }
+    if(threads == 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online < 1 ? 1 : online > MAX_THREADS ? MAX_THREADS : (int)online;
+    }
+    if(manifest)
+    {
+        return runManifest(manifestName, threads);
+    }
+    // the prompts of the streaming mode don't mix with its output
+    FILE *prompts = stream ? stderr : stdout;
+    Transform transform = {&shifter, NULL};
+    if(key != NULL)
+    {
+        if(!keyAction && (action = desiredAction(prompts)) < 0)
+        {
+            fprintf(stderr, "ERROR: The input ended before the action\n");
+            return 1;
+        }
+        if(!initKeyShifter(&keyShifter, key, action))
+        {
+            fprintf(stderr, "ERROR: The key should be 1 to %d letters and numbers\n",
+                    MAX_KEY_LENGTH);
+            return 1;
+        }
+        transform.keyShifter = &keyShifter;
+    }
+    else if(!detect)
+    {
+        if(shift < 0)
+        {
+            shift = desiredShift(prompts);
+            action = shift < 0 ? -1 : desiredAction(prompts);
+            if(action < 0)
+            {
+                fprintf(stderr, "ERROR: The input ended before the %s\n",
+                        shift < 0 ? "shift" : "action");
+                return 1;
+            }
+        }
+        initShifter(&shifter, shift, action);
+    }
+    if(mapped)
+    {
+        return shiftMapped(argv[0], outputName, threads, detect ? NULL : &transform);
+    }
+    if(pipelined)
+    {
+        return shiftPipelined(&transform);
+    }
+    if(stream)
+    {
+        int failed = shiftFiles(argv, numOfFiles, detect ? NULL : &transform);
+        if(fflush(stdout) != 0)
+        {
+            failed = 1;
+        }
+        return failed;
+    }
     char string[101];
     /* the size of the array is 101 in case the user input is 100 chars long, so the function can
      * add the EOS without deleting the last char
      */
     char alteredString[101];
-    shift = desiredShift();
-    action = desiredAction();
     fgets(string, sizeof(string), stdin);
     while(string[i] && i <= 100)
     {
@@ -229,17 +1331,19 @@ int main()
         {
             string[i] = EOS;
         }
-        switch (action)
-        {
-            case 1:
-                alteredString[i] = encrypt(shift, string[i]);
-                break;
-            case 0:
-                alteredString[i] = decrypt(shift, string[i]);
-                break;
-        }
+        alteredString[i] = string[i];
         i++;
     }
+    alteredString[i] = EOS;
+    if(detect)
+    {
+        uint64_t histogram[NUM_OF_BYTES] = {0};
+        addHistogram(histogram, (unsigned char *)string, (size_t)i);
+        shift = detectShift(histogram);
+        fprintf(stderr, "Detected shift: %d\n", shift);
+        initShifter(&shifter, shift, 0);
+    }
+    transformBuffer(&transform, (unsigned char *)alteredString, (size_t)i, 0);
 
     printf("\"%s\" -> \"%s\"\n", string, alteredString);
     return 0;
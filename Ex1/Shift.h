@@ -0,0 +1,34 @@
+/**
+ * @file Shift.h
+ * @author  Vitaly Frolov vitaly.frolov@mail.huji.ac.il
+ * @version 1.0
+ * @date 1 Nov 2015
+ *
+ * @brief The prompts of the system that encrypts\decrypts user input.
+ *
+ * @section DESCRIPTION
+ * The characters are encrypted\decrypted by the Shifter library, the system asks the user for
+ * the shift and the action unless they are given on the command line.
+ */
+#ifndef SHIFT_H
+#define SHIFT_H
+
+#include <stdio.h>
+#include "Shifter.h"
+
+// ------------------------------ functions -----------------------------
+/**
+ * @brief Gets the desired shift from the user.
+ * @param prompts the stream the prompts are printed to
+ * @return The desired shift, -1 if the input ended before it.
+ */
+int desiredShift(FILE *prompts);
+
+/**
+ * @brief Gets the desired action from the user encryption or decryption.
+ * @param prompts the stream the prompts are printed to
+ * @return 1 for encryption, 0 for decryption, -1 if the input ended before it.
+ */
+int desiredAction(FILE *prompts);
+
+#endif
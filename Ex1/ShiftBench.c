@@ -0,0 +1,338 @@
+/**
+ * @file ShiftBench.c
+ * @author  Vitaly Frolov vitaly.frolov@mail.huji.ac.il
+ * @version 1.0
+ * @date 1 Nov 2015
+ *
+ * @brief Benchmark of the shifter library behind Shift, against the character functions.
+ *
+
+ * @section DESCRIPTION
+ * Generates a reproducible text in memory and measures how fast every way of shifting it
+ * goes through it.
+ * Input  : The sizes of the texts, optionally the amount of runs, the shift and the action.
+ * Process: Shifts every text in place with encrypt\decrypt character by character, with the
+ *          translation table and with shift_buffer, after checking they all agree.
+ * Output : A CSV line per way and size with the MB/s.
+ */
+
+ // ------------------------------ includes -----------------------------
+// needed for clock_gettime under -std=c99
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include "Shifter.h"
+
+// -------------------------- const definitions -------------------------
+/**
+ * @def TRUE 1
+ * @brief A macro that sets true value to be 1.
+ */
+#define TRUE 1
+/**
+ * @def FALSE 0
+ * @brief A macro that sets false value to be 0.
+ */
+#define FALSE 0
+/**
+ * @def RUNS_FLAG "-r"
+ * @brief A macro that sets the flag that is followed by the amount of measured runs.
+ */
+#define RUNS_FLAG "-r"
+/**
+ * @def ENCRYPT_FLAG "-e"
+ * @brief A macro that sets the flag that is followed by the shift to encrypt by.
+ */
+#define ENCRYPT_FLAG "-e"
+/**
+ * @def DECRYPT_FLAG "-d"
+ * @brief A macro that sets the flag that is followed by the shift to decrypt by.
+ */
+#define DECRYPT_FLAG "-d"
+/**
+ * @def DEFAULT_RUNS 5
+ * @brief A macro that sets the amount of measured runs of every way and size.
+ */
+#define DEFAULT_RUNS 5
+/**
+ * @def MAX_RUNS 1000
+ * @brief A macro that sets the most measured runs.
+ */
+#define MAX_RUNS 1000
+/**
+ * @def DEFAULT_SHIFT 3
+ * @brief A macro that sets the shift that is benchmarked unless another one is given.
+ */
+#define DEFAULT_SHIFT 3
+/**
+ * @def MAX_SIZES 64
+ * @brief A macro that sets the most text sizes benchmarked at once.
+ */
+#define MAX_SIZES 64
+/**
+ * @def MIN_RUN_BYTES 67108864
+ * @brief A macro that sets the least amount of bytes a measured run shifts, small texts are
+ * shifted again and again until they add up to it.
+ */
+#define MIN_RUN_BYTES 67108864
+/**
+ * @def SEED 0x9E3779B97F4A7C15
+ * @brief A macro that sets the seed of every text, so they are the same on every run.
+ */
+#define SEED 0x9E3779B97F4A7C15ULL
+/**
+ * @def BYTES_IN_MB 1048576.0
+ * @brief A macro that sets the amount of bytes in the megabytes the speed is given in.
+ */
+#define BYTES_IN_MB 1048576.0
+
+// ------------------------------ types -----------------------------
+/**
+ * @enum ShiftWay
+ * @brief The ways a text is shifted.
+ */
+typedef enum ShiftWay
+{
+    LEGACY_WAY,
+    TABLE_WAY,
+    KERNEL_WAY,
+    NUM_OF_WAYS
+} ShiftWay;
+
+/**
+ * @brief The names of the ways, as printed in the CSV.
+ */
+static const char *const WAY_NAMES[NUM_OF_WAYS] = {"legacy", "table", "kernel"};
+
+// ------------------------------ functions -----------------------------
+/**
+ * @brief Generates a text of words of letters and numbers between spaces, punctuation and
+ * new lines, the same text for the same size.
+ * @param text the text
+ * @param size the size of the text
+ */
+static void generateText(unsigned char *text, size_t size)
+{
+    static const char others[] = " \n.,;!?-";
+    uint64_t random = SEED;
+    for (size_t i = 0; i < size; i++)
+    {
+        // xorshift64*
+        random ^= random >> 12;
+        random ^= random << 25;
+        random ^= random >> 27;
+        uint64_t value = (random * 0x2545F4914F6CDD1DULL) >> 32;
+        switch (value % 8)
+        {
+            case 0:
+                text[i] = (unsigned char)others[(value >> 3) % (sizeof(others) - 1)];
+                break;
+            case 1:
+                text[i] = (unsigned char)(NUM_LOW_BORDER + (value >> 3) % 10);
+                break;
+            case 2:
+                text[i] = (unsigned char)(UPPER_CASE_LOW_BORDER + (value >> 3) % 26);
+                break;
+            default:
+                text[i] = (unsigned char)(LOW_CASE_LOW_BORDER + (value >> 3) % 26);
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Shifts the text in place the given way.
+ * @param way the way
+ * @param text the text
+ * @param size the size of the text
+ * @param shift the shift
+ * @param action 1 for encryption, 0 for decryption
+ */
+static void shiftText(ShiftWay way, unsigned char *text, size_t size, int shift, int action)
+{
+    switch (way)
+    {
+        case LEGACY_WAY:
+            for (size_t i = 0; i < size; i++)
+            {
+                char c = (char)text[i];
+                text[i] = (unsigned char)(action ? encrypt(shift, c) : decrypt(shift, c));
+            }
+            break;
+        case TABLE_WAY:
+        {
+            const unsigned char *table = shiftTable(shift, action);
+            for (size_t i = 0; i < size; i++)
+            {
+                text[i] = table[text[i]];
+            }
+            break;
+        }
+        default:
+            shift_buffer(text, size, shift, action);
+            break;
+    }
+}
+
+/**
+ * @brief The time of a monotonic clock.
+ * @return the time in seconds
+ */
+static double secondsNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Benchmarks every way over a text, after checking that they shift it the same.
+ * @param size the size of the text
+ * @param runs the amount of measured runs of every way
+ * @param shift the shift
+ * @param action 1 for encryption, 0 for decryption
+ * @return TRUE if the text was benchmarked, FALSE if the memory ran out or the ways disagree
+ */
+static int benchmarkSize(size_t size, int runs, int shift, int action)
+{
+    unsigned char *texts[NUM_OF_WAYS] = {NULL};
+    int allocated = TRUE;
+    for (int way = 0; way < NUM_OF_WAYS; way++)
+    {
+        texts[way] = malloc(size);
+        allocated = allocated && texts[way] != NULL;
+    }
+    int agree = allocated;
+    for (int way = 0; agree && way < NUM_OF_WAYS; way++)
+    {
+        generateText(texts[way], size);
+        shiftText((ShiftWay)way, texts[way], size, shift, action);
+        agree = memcmp(texts[way], texts[LEGACY_WAY], size) == 0;
+        if(!agree)
+        {
+            fprintf(stderr, "ERROR: %s doesn't shift like %s\n", WAY_NAMES[way],
+                    WAY_NAMES[LEGACY_WAY]);
+        }
+    }
+    // the text is shifted over and over, which is as fast as shifting a new one
+    size_t repeats = size >= MIN_RUN_BYTES ? 1 : MIN_RUN_BYTES / size;
+    for (int way = 0; agree && way < NUM_OF_WAYS; way++)
+    {
+        double sum = 0;
+        double minimum = INFINITY;
+        double maximum = 0;
+        for (int run = 0; run < runs; run++)
+        {
+            double start = secondsNow();
+            for (size_t i = 0; i < repeats; i++)
+            {
+                shiftText((ShiftWay)way, texts[way], size, shift, action);
+            }
+            double seconds = secondsNow() - start;
+            double megabytesPerSecond = (double)size * (double)repeats / BYTES_IN_MB /
+                                        (seconds > 0 ? seconds : 1e-9);
+            sum += megabytesPerSecond;
+            minimum = fmin(minimum, megabytesPerSecond);
+            maximum = fmax(maximum, megabytesPerSecond);
+        }
+        printf("%s,%zu,%d,%.1f,%.1f,%.1f\n", WAY_NAMES[way], size, runs, sum / runs, minimum,
+               maximum);
+        fflush(stdout);
+    }
+    for (int way = 0; way < NUM_OF_WAYS; way++)
+    {
+        free(texts[way]);
+    }
+    if(!allocated)
+    {
+        fprintf(stderr, "Out of memory\n");
+    }
+    return agree;
+}
+
+/**
+ * @brief Parses a size, a number optionally followed by K, M or G (powers of 1024).
+ * @param arg the argument
+ * @return the size in bytes, 0 if the argument isn't a positive size
+ */
+static size_t parseSize(const char *arg)
+{
+    char *end;
+    unsigned long long size = strtoull(arg, &end, 10);
+    if(end == arg || arg[0] == '-')
+    {
+        return 0;
+    }
+    const char *units = "KMG";
+    const char *unit = *end == '\0' ? NULL : strchr(units, *end);
+    if(unit != NULL && end[1] == '\0')
+    {
+        size <<= 10 * (unit - units + 1);
+    }
+    else if(*end != '\0')
+    {
+        return 0;
+    }
+    return (size_t)size;
+}
+
+/**
+ * @brief The main function. benchmarks the character functions, the translation table and
+ * shift_buffer over a text of every given size.
+ * @param argc amount of arguments
+ * @param argv the args, the flags and the sizes of the texts
+ * @return 0 if every text was benchmarked, 1 otherwise
+ */
+int main(int argc, char *argv[])
+{
+    int runs = DEFAULT_RUNS;
+    int shift = DEFAULT_SHIFT;
+    int action = 1;
+    size_t sizes[MAX_SIZES];
+    int numOfSizes = 0;
+    int wrong = FALSE;
+    for (int i = 1; i < argc && !wrong; i++)
+    {
+        if(strcmp(argv[i], RUNS_FLAG) == 0 && i + 1 < argc)
+        {
+            runs = atoi(argv[++i]);
+            wrong = runs < 1 || runs > MAX_RUNS;
+        }
+        else if((strcmp(argv[i], ENCRYPT_FLAG) == 0 || strcmp(argv[i], DECRYPT_FLAG) == 0) &&
+                i + 1 < argc)
+        {
+            action = strcmp(argv[i++], ENCRYPT_FLAG) == 0;
+            shift = atoi(argv[i]);
+            wrong = shift < 0 || shift > MAX_SHIFT;
+        }
+        else if(numOfSizes < MAX_SIZES && (sizes[numOfSizes] = parseSize(argv[i])) != 0)
+        {
+            numOfSizes++;
+        }
+        else
+        {
+            wrong = TRUE;
+        }
+    }
+    if(wrong || numOfSizes == 0)
+    {
+        fprintf(stderr, "Wrong parameters. Usage:\n"
+                "ShiftBench [-r runs] [-e shift | -d shift] size...\n"
+                "sizes as 100 4K 64M 1G\n");
+        return 1;
+    }
+    printf("way,bytes,runs,mb_per_s_mean,mb_per_s_min,mb_per_s_max\n");
+    for (int i = 0; i < numOfSizes; i++)
+    {
+        if(!benchmarkSize(sizes[i], runs, shift, action))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file ShiftCharacters.c
+ * @author  Vitaly Frolov vitaly.frolov@mail.huji.ac.il
+ * @version 1.0
+ * @date 1 Nov 2015
+ *
+ * @brief The functions that encrypt\decrypt a single character.
+ *
+
+ * @section DESCRIPTION
+ * The shifting of a single character, the definition of what the Shifter library does.
+ * Input  : A character, the shift and the action.
+ * Process: Shifts the character inside its range.
+ * Output : The encrypted\decrypted character.
+ */
+
+// ------------------------------ includes -----------------------------
+#include "Shifter.h"
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * @brief Shifts the character that was received by the desired amount.
+ * @param lowerBound The lower boundary of the characters set
+ * @param upperBound The upper boundary of the characters set
+ * @param shift The desired amount for the character to be shifted
+ * @param c The character that needs to be shifted
+ * @return The character c after it was shifted
+ */
+char charShifter(int lowerBound, int upperBound, int shift, char c)
+{
+    // cleanShift is needed in case the shift amount exceeds the amount of characters more than once
+    int cleanShift = shift - (shift / (upperBound - lowerBound)) * (upperBound - lowerBound);
+    if(upperBound < c + shift)
+    {
+        // In case the shift amount exceeds the upper boundary
+        return (lowerBound + cleanShift - ( upperBound - c + 1));
+    }
+    else
+    {
+        return c + cleanShift;
+    }
+}
+
+/**
+ * @brief Decrypts the character that was received by the desired amount.
+ * @param shift The desired amount for the character to be shifted
+ * @param c The character that needs to be shifted
+ * @return The character c after it was decrypted
+ */
+char decrypt(int shift, char c)
+{
+    /* Decryption is actually encryption in the other direction, so the only thing needs to be
+     * changed is the shift
+     */
+    int decryptedChar;
+    if(LOW_CASE_LOW_BORDER <= c && c <= LOW_CASE_UPPER_BORDER)
+    {
+        decryptedChar = charShifter(LOW_CASE_LOW_BORDER, LOW_CASE_UPPER_BORDER,
+                                    LOW_CASE_UPPER_BORDER - LOW_CASE_LOW_BORDER - shift + 1, c);
+    }
+    else if(UPPER_CASE_LOW_BORDER <= c && c <= UPPER_CASE_UPPER_BORDER)
+    {
+        decryptedChar = charShifter(UPPER_CASE_LOW_BORDER, UPPER_CASE_UPPER_BORDER,
+                                    UPPER_CASE_UPPER_BORDER - UPPER_CASE_LOW_BORDER - shift + 1, c);
+    }
+    else if(NUM_LOW_BORDER <= c && c <= NUM_UPPER_BORDER)
+    {
+        decryptedChar = charShifter(NUM_LOW_BORDER, NUM_UPPER_BORDER,
+                                    NUM_UPPER_BORDER - NUM_LOW_BORDER - shift + 1, c);
+    }
+    else
+    {
+        // in case the char that was given ain't a letter or a number
+        return c;
+    }
+    return decryptedChar;
+}
+
+/**
+ * @brief Encrypts the character that was received by the desired amount.
+ * @param shift The desired amount for the character to be shifted
+ * @param c The character that needs to be shifted
+ * @return The character c after it was encrypted
+ */
+char encrypt(int shift, char c)
+{
+    char encryptedChar;
+    if(LOW_CASE_LOW_BORDER <= c && c <= LOW_CASE_UPPER_BORDER)
+    {
+        encryptedChar = charShifter(LOW_CASE_LOW_BORDER, LOW_CASE_UPPER_BORDER, shift, c);
+    }
+    else if(UPPER_CASE_LOW_BORDER <= c && c <= UPPER_CASE_UPPER_BORDER)
+    {
+        encryptedChar = charShifter(UPPER_CASE_LOW_BORDER, UPPER_CASE_UPPER_BORDER, shift, c);
+    }
+    else if(NUM_LOW_BORDER <= c && c <= NUM_UPPER_BORDER)
+    {
+        encryptedChar = charShifter(NUM_LOW_BORDER, NUM_UPPER_BORDER, shift, c);
+    }
+    else
+    {
+        return c;
+    }
+    return encryptedChar;
+}
+
+/**
+ * @brief Builds the translation table of the shift, the encrypted\decrypted character of
+ * every byte, so a character is encrypted\decrypted with a single lookup instead of the range
+ * tests and the division of charShifter.
+ * @param table the table, NUM_OF_BYTES entries indexed by the unsigned byte
+ * @param shift The desired amount for the characters to be shifted
+ * @param action 1 for encryption, 0 for decryption
+ */
+void buildShiftTable(unsigned char *table, int shift, int action)
+{
+    for (int i = 0; i < NUM_OF_BYTES; i++)
+    {
+        char c = (char)i;
+        table[i] = (unsigned char)(action ? encrypt(shift, c) : decrypt(shift, c));
+    }
+}
@@ -0,0 +1,289 @@
+/**
+ * @file ShiftFuzz.c
+ * @author  Vitaly Frolov vitaly.frolov@mail.huji.ac.il
+ * @version 1.0
+ * @date 1 Nov 2015
+ *
+ * @brief Differential fuzzer of the shifter library against the character functions.
+ *
+
+ * @section DESCRIPTION
+ * Shifts random buffers with the library and character by character with encrypt\decrypt,
+ * and stops at the first byte they don't agree on.
+ * Input  : Optionally the seed and the amount of iterations.
+ * Process: Shifts random bytes at random alignments by random shifts and keys, in one call or
+ *          split in two.
+ * Output : The seed and the iteration of the first disagreement, or that there was none.
+ */
+
+ // ------------------------------ includes -----------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+#include "Shifter.h"
+
+// -------------------------- const definitions -------------------------
+/**
+ * @def TRUE 1
+ * @brief A macro that sets true value to be 1.
+ */
+#define TRUE 1
+/**
+ * @def FALSE 0
+ * @brief A macro that sets false value to be 0.
+ */
+#define FALSE 0
+/**
+ * @def SEED_FLAG "-s"
+ * @brief A macro that sets the flag that is followed by the seed, to repeat a run.
+ */
+#define SEED_FLAG "-s"
+/**
+ * @def DEFAULT_ITERATIONS 100000
+ * @brief A macro that sets the amount of iterations unless another one is given.
+ */
+#define DEFAULT_ITERATIONS 100000
+/**
+ * @def SHORT_BUFFER 512
+ * @brief A macro that sets the most bytes of most of the buffers, around the vector widths.
+ */
+#define SHORT_BUFFER 512
+/**
+ * @def LONG_BUFFER 70000
+ * @brief A macro that sets the most bytes of the rest of the buffers.
+ */
+#define LONG_BUFFER 70000
+/**
+ * @def MAX_ALIGNMENT 64
+ * @brief A macro that sets the most bytes a buffer starts after an aligned address.
+ */
+#define MAX_ALIGNMENT 64
+/**
+ * @def GUARD 64
+ * @brief A macro that sets the amount of bytes after a buffer that mustn't change.
+ */
+#define GUARD 64
+
+// ------------------------------ types -----------------------------
+/**
+ * @struct Case
+ * @brief A random case of the fuzzer.
+ */
+typedef struct Case
+{
+    size_t length;
+    size_t alignment;
+    // where the buffer is split between two calls, length when it is shifted in one
+    size_t split;
+    int shift;
+    int action;
+    // the key, empty to shift by shift
+    char key[MAX_KEY_LENGTH + 1];
+    uint64_t position;
+} Case;
+
+// ------------------------------ functions -----------------------------
+/**
+ * @brief The next number of the xorshift64* generator of the fuzzer.
+ * @param random the state of the generator
+ * @return a pseudo random number
+ */
+static uint64_t nextRandom(uint64_t *random)
+{
+    *random ^= *random >> 12;
+    *random ^= *random << 25;
+    *random ^= *random >> 27;
+    return *random * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief A random letter or number.
+ * @param random the state of the generator
+ * @return the character
+ */
+static char randomKeyCharacter(uint64_t *random)
+{
+    static const char characters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                     "0123456789";
+    return characters[nextRandom(random) % (sizeof(characters) - 1)];
+}
+
+/**
+ * @brief Draws a random case and fills the buffer with random bytes, half the time only
+ * letters and numbers.
+ * @param random the state of the generator
+ * @param testCase the case
+ * @param buffer the buffer, at least MAX_ALIGNMENT + LONG_BUFFER + GUARD bytes
+ */
+static void drawCase(uint64_t *random, Case *testCase, unsigned char *buffer)
+{
+    size_t maxLength = nextRandom(random) % 8 == 0 ? LONG_BUFFER : SHORT_BUFFER;
+    testCase->length = (size_t)(nextRandom(random) % (maxLength + 1));
+    testCase->alignment = (size_t)(nextRandom(random) % MAX_ALIGNMENT);
+    testCase->split = nextRandom(random) % 2 == 0 ? testCase->length :
+                      (size_t)(nextRandom(random) % (testCase->length + 1));
+    testCase->shift = (int)(nextRandom(random) % (MAX_SHIFT + 1));
+    testCase->action = (int)(nextRandom(random) % 2);
+    size_t keyLength = nextRandom(random) % 2 == 0 ? 0 :
+                       1 + (size_t)(nextRandom(random) % MAX_KEY_LENGTH);
+    for (size_t i = 0; i < keyLength; i++)
+    {
+        testCase->key[i] = randomKeyCharacter(random);
+    }
+    testCase->key[keyLength] = '\0';
+    testCase->position = nextRandom(random) % 2 == 0 ? 0 : nextRandom(random) >> 16;
+    int alphanumeric = nextRandom(random) % 2 == 0;
+    for (size_t i = 0; i < MAX_ALIGNMENT + LONG_BUFFER + GUARD; i++)
+    {
+        buffer[i] = alphanumeric ? (unsigned char)randomKeyCharacter(random) :
+                    (unsigned char)nextRandom(random);
+    }
+}
+
+/**
+ * @brief The shift of a key character, the same as initKeyShifter gives it.
+ * @param c the key character
+ * @return the shift
+ */
+static int keyCharacterShift(char c)
+{
+    if(LOW_CASE_LOW_BORDER <= c && c <= LOW_CASE_UPPER_BORDER)
+    {
+        return c - LOW_CASE_LOW_BORDER;
+    }
+    if(UPPER_CASE_LOW_BORDER <= c && c <= UPPER_CASE_UPPER_BORDER)
+    {
+        return c - UPPER_CASE_LOW_BORDER;
+    }
+    return c - NUM_LOW_BORDER;
+}
+
+/**
+ * @brief Shifts the buffer of the case character by character with encrypt\decrypt.
+ * @param testCase the case
+ * @param buffer the buffer
+ */
+static void shiftExpected(const Case *testCase, unsigned char *buffer)
+{
+    size_t keyLength = strlen(testCase->key);
+    for (size_t i = 0; i < testCase->length; i++)
+    {
+        int shift = testCase->shift;
+        if(keyLength > 0)
+        {
+            shift = keyCharacterShift(testCase->key[(testCase->position + i) % keyLength]);
+        }
+        char c = (char)buffer[i];
+        buffer[i] = (unsigned char)(testCase->action ? encrypt(shift, c) : decrypt(shift, c));
+    }
+}
+
+/**
+ * @brief Shifts the buffer of the case with the library, in one call or in two.
+ * @param testCase the case
+ * @param keyShifter a key shifter for the key of the case
+ * @param buffer the buffer
+ * @return TRUE if the library accepted the case
+ */
+static int shiftActual(const Case *testCase, KeyShifter *keyShifter, unsigned char *buffer)
+{
+    size_t rest = testCase->length - testCase->split;
+    if(testCase->key[0] == '\0')
+    {
+        return shift_buffer(buffer, testCase->split, testCase->shift, testCase->action) &&
+               shift_buffer(buffer + testCase->split, rest, testCase->shift, testCase->action);
+    }
+    if(!initKeyShifter(keyShifter, testCase->key, testCase->action))
+    {
+        return FALSE;
+    }
+    shiftKeyBuffer(keyShifter, buffer, testCase->split, testCase->position);
+    shiftKeyBuffer(keyShifter, buffer + testCase->split, rest,
+                   testCase->position + testCase->split);
+    return TRUE;
+}
+
+/**
+ * @brief Prints the case the library and the character functions disagree on.
+ * @param seed the seed of the run
+ * @param iteration the iteration of the case
+ * @param testCase the case
+ * @param index the index of the first byte they disagree on
+ * @param expected the byte of the character functions
+ * @param actual the byte of the library
+ */
+static void printDisagreement(uint64_t seed, uint64_t iteration, const Case *testCase,
+                              size_t index, unsigned char expected, unsigned char actual)
+{
+    printf("Disagreement seed:%" PRIu64 " iteration:%" PRIu64 " length:%zu alignment:%zu "
+           "split:%zu shift:%d action:%c key:\"%s\" position:%" PRIu64 " index:%zu "
+           "expected:%d actual:%d\n", seed, iteration, testCase->length, testCase->alignment,
+           testCase->split, testCase->shift, testCase->action ? 'e' : 'd', testCase->key,
+           testCase->position, index, expected, actual);
+}
+
+/**
+ * @brief The main function. shifts random buffers with the library and with the character
+ * functions until they disagree or the iterations are done.
+ * @param argc amount of arguments
+ * @param argv the args, -s and the seed and the amount of iterations
+ * @return 0 if they always agreed, 1 otherwise
+ */
+int main(int argc, char *argv[])
+{
+    uint64_t seed = (uint64_t)time(NULL);
+    uint64_t iterations = DEFAULT_ITERATIONS;
+    int wrong = FALSE;
+    for (int i = 1; i < argc && !wrong; i++)
+    {
+        char *end;
+        if(strcmp(argv[i], SEED_FLAG) == 0 && i + 1 < argc)
+        {
+            seed = strtoull(argv[++i], &end, 10);
+            wrong = *argv[i] == '\0' || *end != '\0';
+        }
+        else
+        {
+            iterations = strtoull(argv[i], &end, 10);
+            wrong = *argv[i] == '\0' || *end != '\0' || iterations == 0;
+        }
+    }
+    if(wrong)
+    {
+        fprintf(stderr, "Wrong parameters. Usage:\n"
+                "ShiftFuzz [-s seed] [iterations]\n");
+        return 1;
+    }
+    static unsigned char expected[MAX_ALIGNMENT + LONG_BUFFER + GUARD];
+    static unsigned char actual[MAX_ALIGNMENT + LONG_BUFFER + GUARD];
+    static KeyShifter keyShifter;
+    // a zero seed would keep the generator at zero
+    uint64_t random = seed == 0 ? 1 : seed;
+    for (uint64_t iteration = 0; iteration < iterations; iteration++)
+    {
+        Case testCase;
+        drawCase(&random, &testCase, expected);
+        memcpy(actual, expected, sizeof(actual));
+        shiftExpected(&testCase, expected + testCase.alignment);
+        if(!shiftActual(&testCase, &keyShifter, actual + testCase.alignment))
+        {
+            printf("Rejected seed:%" PRIu64 " iteration:%" PRIu64 "\n", seed, iteration);
+            return 1;
+        }
+        // the bytes around the buffer are compared as well, they must stay as they were
+        for (size_t i = 0; i < sizeof(actual); i++)
+        {
+            if(expected[i] != actual[i])
+            {
+                printDisagreement(seed, iteration, &testCase, i - testCase.alignment,
+                                  expected[i], actual[i]);
+                return 1;
+            }
+        }
+    }
+    printf("Iterations:%" PRIu64 " seed:%" PRIu64 " identical\n", iterations, seed);
+    return 0;
+}
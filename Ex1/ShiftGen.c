@@ -0,0 +1,95 @@
+/**
+ * @file ShiftGen.c
+ * @author  Vitaly Frolov vitaly.frolov@mail.huji.ac.il
+ * @version 1.0
+ * @date 1 Nov 2015
+ *
+ * @brief System that generates the translation tables of the Shifter library.
+ *
+
+ * @section DESCRIPTION
+ * The system writes the C source of every translation table, so the tables are read only
+ * data of the library and no run has to build them.
+ * Input  : None.
+ * Process: Builds the table of every shift and action with the character functions.
+ * Output : The source of ShiftTables.c.
+ */
+
+// ------------------------------ includes -----------------------------
+#include <stdio.h>
+#include "Shifter.h"
+
+// -------------------------- const definitions -------------------------
+/**
+ * @def NUM_OF_ACTIONS 2
+ * @brief A macro that sets the amount of actions, decryption and encryption.
+ */
+#define NUM_OF_ACTIONS 2
+
+/**
+ * @def BYTES_IN_ROW 16
+ * @brief A macro that sets the amount of table entries written in a row.
+ */
+#define BYTES_IN_ROW 16
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * @brief The main function. the function prints the source of the translation tables and of
+ * shiftTable.
+ * @return 0, to tell the system the execution ended without errors.
+ */
+int main(void)
+{
+    printf("/**\n"
+           " * @file ShiftTables.c\n"
+           " * @brief The translation tables of the Shifter library, generated by ShiftGen.\n"
+           " * don't edit, the Makefile generates it again.\n"
+           " */\n"
+           "\n"
+           "// ------------------------------ includes -----------------------------\n"
+           "#include \"Shifter.h\"\n"
+           "\n"
+           "// ------------------------------ globals -----------------------------\n"
+           "/**\n"
+           " * @brief The translation table of every action, decryption first, and every "
+           "shift.\n"
+           " */\n"
+           "static const unsigned char shiftTables[%d][MAX_SHIFT + 1][NUM_OF_BYTES] = {\n",
+           NUM_OF_ACTIONS);
+    for (int action = 0; action < NUM_OF_ACTIONS; action++)
+    {
+        printf("    {\n");
+        for (int shift = 0; shift <= MAX_SHIFT; shift++)
+        {
+            unsigned char table[NUM_OF_BYTES];
+            buildShiftTable(table, shift, action);
+            printf("        {\n");
+            for (int i = 0; i < NUM_OF_BYTES; i++)
+            {
+                printf("%s%3d%s", i % BYTES_IN_ROW == 0 ? "            " : "", table[i],
+                       i == NUM_OF_BYTES - 1 ? "\n" : i % BYTES_IN_ROW == BYTES_IN_ROW - 1 ?
+                       ",\n" : ", ");
+            }
+            printf("        }%s\n", shift < MAX_SHIFT ? "," : "");
+        }
+        printf("    }%s\n", action < NUM_OF_ACTIONS - 1 ? "," : "");
+    }
+    printf("};\n"
+           "\n"
+           "// ------------------------------ functions -----------------------------\n"
+           "\n"
+           "/**\n"
+           " * @brief Gets the translation table of the shift, generated when the library was "
+           "built.\n"
+           " * @param shift The desired amount for the characters to be shifted, 0 to "
+           "MAX_SHIFT\n"
+           " * @param action 1 for encryption, 0 for decryption\n"
+           " * @return the table, NUM_OF_BYTES entries indexed by the unsigned byte\n"
+           " */\n"
+           "const unsigned char *shiftTable(int shift, int action)\n"
+           "{\n"
+           "    return shiftTables[action ? 1 : 0][shift];\n"
+           "}\n");
+    return ferror(stdout) ? 1 : 0;
+}
@@ -0,0 +1,555 @@
+/**
+ * @file Shifter.c
+ * @author  Vitaly Frolov vitaly.frolov@mail.huji.ac.il
+ * @version 1.0
+ * @date 1 Nov 2015
+ *
+ * @brief A library that encrypts\decrypts buffers by shifting their characters.
+ *
+
+ * @section DESCRIPTION
+ * The shifting kernels behind Shift, the translation table one and SSE2\AVX2 ones picked at
+ * runtime, for a single shift and for a key, and the detection of the shift of an input.
+ * Input  : The buffers, the shift or the key and the action.
+ * Process: Shifts every letter and number of the buffers inside its range.
+ * Output : The encrypted\decrypted buffers, in place.
+ */
+
+// ------------------------------ includes -----------------------------
+#include <math.h>
+#include <string.h>
+#include "Shifter.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+/**
+ * @def X86_SIMD
+ * @brief A macro that marks that the SSE2\AVX2 shifting kernels are compiled in.
+ */
+#define X86_SIMD
+#endif
+
+// -------------------------- const definitions -------------------------
+/**
+ * @def HISTOGRAM_BANKS 4
+ * @brief A macro that sets the amount of histograms adjacent bytes are spread over, so
+ * repeated bytes don't wait for each other's increments.
+ */
+#define HISTOGRAM_BANKS 4
+
+/**
+ * @def LETTERS_SHARE 0.9
+ * @brief A macro that sets the share of the letters among the letters and numbers of english
+ * text.
+ */
+#define LETTERS_SHARE 0.9
+
+/**
+ * @def UNLIKELY_CHARACTER 1e-6
+ * @brief A macro that sets the likelihood of a letter or number that decrypts to something
+ * else.
+ */
+#define UNLIKELY_CHARACTER 1e-6
+
+// ------------------------------ globals -----------------------------
+/**
+ * @brief The lower and upper boundaries of the ranges of characters that are shifted, in the
+ * order of the ranges of Shifter.
+ */
+static const int rangeBounds[NUM_OF_RANGES][2] = {
+    {LOW_CASE_LOW_BORDER, LOW_CASE_UPPER_BORDER},
+    {UPPER_CASE_LOW_BORDER, UPPER_CASE_UPPER_BORDER},
+    {NUM_LOW_BORDER, NUM_UPPER_BORDER}
+};
+
+/**
+ * @brief The frequencies of the letters a to z in english text, in percents.
+ */
+static const double letterFrequencies[] = {
+    8.167, 1.492, 2.782, 4.253, 12.702, 2.228, 2.015, 6.094, 6.966, 0.153, 0.772, 4.025, 2.406,
+    6.749, 7.507, 1.929, 0.095, 5.987, 6.327, 9.056, 2.758, 0.978, 2.360, 0.150, 1.974, 0.074
+};
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * @brief Encrypts\decrypts the buffer in place with a lookup in the translation table per
+ * byte.
+ * @param shifter the shifter
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ */
+static void shiftScalar(const Shifter *shifter, unsigned char *buffer, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        buffer[i] = shifter->table[buffer[i]];
+    }
+}
+
+#ifdef X86_SIMD
+/**
+ * @brief Encrypts\decrypts the buffer in place 16 bytes at a time, finding the ranges and the
+ * characters that wrap around with SSE2 compares.
+ * @param shifter the shifter
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ */
+__attribute__((target("sse2")))
+static void shiftSse2(const Shifter *shifter, unsigned char *buffer, size_t length)
+{
+    __m128i belowRange[NUM_OF_RANGES], aboveRange[NUM_OF_RANGES], wrapAbove[NUM_OF_RANGES];
+    __m128i add[NUM_OF_RANGES], wrapSize[NUM_OF_RANGES];
+    for (int r = 0; r < NUM_OF_RANGES; r++)
+    {
+        belowRange[r] = _mm_set1_epi8(shifter->belowRange[r]);
+        aboveRange[r] = _mm_set1_epi8(shifter->aboveRange[r]);
+        wrapAbove[r] = _mm_set1_epi8(shifter->wrapAbove[r]);
+        add[r] = _mm_set1_epi8(shifter->add[r]);
+        wrapSize[r] = _mm_set1_epi8(shifter->wrapSize[r]);
+    }
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(buffer + i));
+        __m128i delta = _mm_setzero_si128();
+        for (int r = 0; r < NUM_OF_RANGES; r++)
+        {
+            // the bytes from 128 up are negative and in none of the ranges
+            __m128i inRange = _mm_and_si128(_mm_cmpgt_epi8(bytes, belowRange[r]),
+                                            _mm_cmpgt_epi8(aboveRange[r], bytes));
+            __m128i wrap = _mm_and_si128(_mm_cmpgt_epi8(bytes, wrapAbove[r]), wrapSize[r]);
+            delta = _mm_or_si128(delta, _mm_and_si128(inRange, _mm_sub_epi8(add[r], wrap)));
+        }
+        _mm_storeu_si128((__m128i *)(buffer + i), _mm_add_epi8(bytes, delta));
+    }
+    shiftScalar(shifter, buffer + i, length - i);
+}
+
+/**
+ * @brief Encrypts\decrypts the buffer in place 32 bytes at a time, finding the ranges and the
+ * characters that wrap around with AVX2 compares.
+ * @param shifter the shifter
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ */
+__attribute__((target("avx2")))
+static void shiftAvx2(const Shifter *shifter, unsigned char *buffer, size_t length)
+{
+    __m256i belowRange[NUM_OF_RANGES], aboveRange[NUM_OF_RANGES], wrapAbove[NUM_OF_RANGES];
+    __m256i add[NUM_OF_RANGES], wrapSize[NUM_OF_RANGES];
+    for (int r = 0; r < NUM_OF_RANGES; r++)
+    {
+        belowRange[r] = _mm256_set1_epi8(shifter->belowRange[r]);
+        aboveRange[r] = _mm256_set1_epi8(shifter->aboveRange[r]);
+        wrapAbove[r] = _mm256_set1_epi8(shifter->wrapAbove[r]);
+        add[r] = _mm256_set1_epi8(shifter->add[r]);
+        wrapSize[r] = _mm256_set1_epi8(shifter->wrapSize[r]);
+    }
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(buffer + i));
+        __m256i delta = _mm256_setzero_si256();
+        for (int r = 0; r < NUM_OF_RANGES; r++)
+        {
+            __m256i inRange = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, belowRange[r]),
+                                               _mm256_cmpgt_epi8(aboveRange[r], bytes));
+            __m256i wrap = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, wrapAbove[r]),
+                                            wrapSize[r]);
+            delta = _mm256_or_si256(delta,
+                                    _mm256_and_si256(inRange, _mm256_sub_epi8(add[r], wrap)));
+        }
+        _mm256_storeu_si256((__m256i *)(buffer + i), _mm256_add_epi8(bytes, delta));
+    }
+    shiftScalar(shifter, buffer + i, length - i);
+}
+#endif
+
+/**
+ * @brief Works out how the vector kernels shift a range of characters to get the same
+ * characters charShifter does.
+ * @param lowerBound The lower boundary of the characters set
+ * @param upperBound The upper boundary of the characters set
+ * @param shift The desired amount for the characters to be shifted
+ * @param action 1 for encryption, 0 for decryption
+ * @param add will be set to the amount added to the characters of the range
+ * @param wrapAbove will be set to the character above which the characters wrap around
+ */
+static void rangeShift(int lowerBound, int upperBound, int shift, int action, signed char *add,
+                       signed char *wrapAbove)
+{
+    int size = upperBound - lowerBound;
+    // decrypt shifts the other way just as it calls charShifter
+    int rangeShift = action ? shift : size - shift + 1;
+    int above = upperBound - rangeShift;
+    // a character c wraps around when upperBound < c + shift, no character at all or all of them
+    if(above < lowerBound - 1)
+    {
+        above = lowerBound - 1;
+    }
+    else if(above > upperBound)
+    {
+        above = upperBound;
+    }
+    *wrapAbove = (signed char)above;
+    *add = (signed char)(rangeShift - (rangeShift / size) * size);
+}
+
+/**
+ * @brief Sets the bounds of the ranges of characters the vector kernels compare to.
+ * @param belowRange will be set to the character below every range
+ * @param aboveRange will be set to the character above every range
+ * @param wrapSize will be set to the amount of characters in every range
+ */
+static void setRanges(signed char *belowRange, signed char *aboveRange, signed char *wrapSize)
+{
+    for (int r = 0; r < NUM_OF_RANGES; r++)
+    {
+        belowRange[r] = (signed char)(rangeBounds[r][0] - 1);
+        aboveRange[r] = (signed char)(rangeBounds[r][1] + 1);
+        wrapSize[r] = (signed char)(rangeBounds[r][1] - rangeBounds[r][0] + 1);
+    }
+}
+
+/**
+ * @brief Sets the shifter up for the shift and picks the fastest kernel the running cpu
+ * supports.
+ * @param shifter the shifter
+ * @param shift The desired amount for the characters to be shifted
+ * @param action 1 for encryption, 0 for decryption
+ */
+void initShifter(Shifter *shifter, int shift, int action)
+{
+    shifter->table = shiftTable(shift, action);
+    setRanges(shifter->belowRange, shifter->aboveRange, shifter->wrapSize);
+    for (int r = 0; r < NUM_OF_RANGES; r++)
+    {
+        rangeShift(rangeBounds[r][0], rangeBounds[r][1], shift, action, &shifter->add[r],
+                   &shifter->wrapAbove[r]);
+    }
+    shifter->kernel = shiftScalar;
+#ifdef X86_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        shifter->kernel = shiftAvx2;
+    }
+    else if(__builtin_cpu_supports("sse2"))
+    {
+        shifter->kernel = shiftSse2;
+    }
+#endif
+}
+
+/**
+ * @brief Encrypts\decrypts the buffer in place.
+ * @param shifter the shifter
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ */
+void shiftBuffer(const Shifter *shifter, unsigned char *buffer, size_t length)
+{
+    shifter->kernel(shifter, buffer, length);
+}
+
+/**
+ * @brief Encrypts\decrypts the buffer in place by the shift, with the fastest kernel the
+ * running cpu supports. the buffer isn't copied, so it may be anywhere in the memory of the
+ * caller.
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ * @param shift The desired amount for the characters to be shifted, 0 to MAX_SHIFT
+ * @param action 1 for encryption, 0 for decryption
+ * @return 1 if the buffer was shifted, 0 if the shift isn't valid
+ */
+int shift_buffer(void *buffer, size_t length, int shift, int action)
+{
+    if(shift < 0 || shift > MAX_SHIFT)
+    {
+        return 0;
+    }
+    Shifter shifter;
+    initShifter(&shifter, shift, action);
+    shiftBuffer(&shifter, buffer, length);
+    return 1;
+}
+
+/**
+ * @brief Encrypts\decrypts the buffer in place by the key with a lookup in the table of the
+ * shift of the key character per byte.
+ * @param keyShifter the key shifter
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ * @param position the position of the buffer in the input
+ */
+static void shiftKeyScalar(const KeyShifter *keyShifter, unsigned char *buffer, size_t length,
+                           uint64_t position)
+{
+    int k = (int)(position % (uint64_t)keyShifter->keyLength);
+    for (size_t i = 0; i < length; i++)
+    {
+        buffer[i] = keyShifter->tables[k][buffer[i]];
+        if(++k == keyShifter->keyLength)
+        {
+            k = 0;
+        }
+    }
+}
+
+#ifdef X86_SIMD
+/**
+ * @brief Encrypts\decrypts the buffer in place by the key 16 bytes at a time like shiftSse2,
+ * with the amounts added and the wrap around points loaded from the key pattern.
+ * @param keyShifter the key shifter
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ * @param position the position of the buffer in the input
+ */
+__attribute__((target("sse2")))
+static void shiftKeySse2(const KeyShifter *keyShifter, unsigned char *buffer, size_t length,
+                         uint64_t position)
+{
+    __m128i belowRange[NUM_OF_RANGES], aboveRange[NUM_OF_RANGES], wrapSize[NUM_OF_RANGES];
+    for (int r = 0; r < NUM_OF_RANGES; r++)
+    {
+        belowRange[r] = _mm_set1_epi8(keyShifter->belowRange[r]);
+        aboveRange[r] = _mm_set1_epi8(keyShifter->aboveRange[r]);
+        wrapSize[r] = _mm_set1_epi8(keyShifter->wrapSize[r]);
+    }
+    int keyLength = keyShifter->keyLength;
+    int k = (int)(position % (uint64_t)keyLength);
+    int step = 16 % keyLength;
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(buffer + i));
+        __m128i delta = _mm_setzero_si128();
+        for (int r = 0; r < NUM_OF_RANGES; r++)
+        {
+            __m128i add = _mm_loadu_si128((const __m128i *)(keyShifter->add[r] + k));
+            __m128i wrapAbove = _mm_loadu_si128((const __m128i *)(keyShifter->wrapAbove[r] + k));
+            __m128i inRange = _mm_and_si128(_mm_cmpgt_epi8(bytes, belowRange[r]),
+                                            _mm_cmpgt_epi8(aboveRange[r], bytes));
+            __m128i wrap = _mm_and_si128(_mm_cmpgt_epi8(bytes, wrapAbove), wrapSize[r]);
+            delta = _mm_or_si128(delta, _mm_and_si128(inRange, _mm_sub_epi8(add, wrap)));
+        }
+        _mm_storeu_si128((__m128i *)(buffer + i), _mm_add_epi8(bytes, delta));
+        k += step;
+        if(k >= keyLength)
+        {
+            k -= keyLength;
+        }
+    }
+    shiftKeyScalar(keyShifter, buffer + i, length - i, (uint64_t)k);
+}
+
+/**
+ * @brief Encrypts\decrypts the buffer in place by the key 32 bytes at a time like shiftAvx2,
+ * with the amounts added and the wrap around points loaded from the key pattern.
+ * @param keyShifter the key shifter
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ * @param position the position of the buffer in the input
+ */
+__attribute__((target("avx2")))
+static void shiftKeyAvx2(const KeyShifter *keyShifter, unsigned char *buffer, size_t length,
+                         uint64_t position)
+{
+    __m256i belowRange[NUM_OF_RANGES], aboveRange[NUM_OF_RANGES], wrapSize[NUM_OF_RANGES];
+    for (int r = 0; r < NUM_OF_RANGES; r++)
+    {
+        belowRange[r] = _mm256_set1_epi8(keyShifter->belowRange[r]);
+        aboveRange[r] = _mm256_set1_epi8(keyShifter->aboveRange[r]);
+        wrapSize[r] = _mm256_set1_epi8(keyShifter->wrapSize[r]);
+    }
+    int keyLength = keyShifter->keyLength;
+    int k = (int)(position % (uint64_t)keyLength);
+    int step = 32 % keyLength;
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(buffer + i));
+        __m256i delta = _mm256_setzero_si256();
+        for (int r = 0; r < NUM_OF_RANGES; r++)
+        {
+            __m256i add = _mm256_loadu_si256((const __m256i *)(keyShifter->add[r] + k));
+            __m256i wrapAbove = _mm256_loadu_si256(
+                (const __m256i *)(keyShifter->wrapAbove[r] + k));
+            __m256i inRange = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, belowRange[r]),
+                                               _mm256_cmpgt_epi8(aboveRange[r], bytes));
+            __m256i wrap = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, wrapAbove), wrapSize[r]);
+            delta = _mm256_or_si256(delta, _mm256_and_si256(inRange, _mm256_sub_epi8(add, wrap)));
+        }
+        _mm256_storeu_si256((__m256i *)(buffer + i), _mm256_add_epi8(bytes, delta));
+        k += step;
+        if(k >= keyLength)
+        {
+            k -= keyLength;
+        }
+    }
+    shiftKeyScalar(keyShifter, buffer + i, length - i, (uint64_t)k);
+}
+#endif
+
+/**
+ * @brief Sets the key shifter up for the key and picks the fastest kernel the running cpu
+ * supports. every letter of the key shifts by its place in the alphabet, a and A by 0, and
+ * every number by its value.
+ * @param keyShifter the key shifter
+ * @param key the key, letters and numbers only and at most MAX_KEY_LENGTH of them
+ * @param action 1 for encryption, 0 for decryption
+ * @return 1 if the key was set, 0 if it isn't a valid key
+ */
+int initKeyShifter(KeyShifter *keyShifter, const char *key, int action)
+{
+    size_t keyLength = strlen(key);
+    if(keyLength == 0 || keyLength > MAX_KEY_LENGTH)
+    {
+        return 0;
+    }
+    keyShifter->keyLength = (int)keyLength;
+    int shifts[MAX_KEY_LENGTH];
+    for (int k = 0; k < keyShifter->keyLength; k++)
+    {
+        int shift = -1;
+        for (int r = 0; r < NUM_OF_RANGES; r++)
+        {
+            if(rangeBounds[r][0] <= key[k] && key[k] <= rangeBounds[r][1])
+            {
+                shift = key[k] - rangeBounds[r][0];
+            }
+        }
+        if(shift < 0)
+        {
+            return 0;
+        }
+        shifts[k] = shift;
+        keyShifter->tables[k] = shiftTable(shift, action);
+    }
+    setRanges(keyShifter->belowRange, keyShifter->aboveRange, keyShifter->wrapSize);
+    for (int k = 0; k < keyShifter->keyLength + KEY_PATTERN_PADDING; k++)
+    {
+        int shift = shifts[k % keyShifter->keyLength];
+        for (int r = 0; r < NUM_OF_RANGES; r++)
+        {
+            rangeShift(rangeBounds[r][0], rangeBounds[r][1], shift, action,
+                       &keyShifter->add[r][k], &keyShifter->wrapAbove[r][k]);
+        }
+    }
+    keyShifter->kernel = shiftKeyScalar;
+#ifdef X86_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        keyShifter->kernel = shiftKeyAvx2;
+    }
+    else if(__builtin_cpu_supports("sse2"))
+    {
+        keyShifter->kernel = shiftKeySse2;
+    }
+#endif
+    return 1;
+}
+
+/**
+ * @brief Encrypts\decrypts the buffer in place by the key.
+ * @param keyShifter the key shifter
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ * @param position the position of the buffer in the input, where in the key it starts
+ */
+void shiftKeyBuffer(const KeyShifter *keyShifter, unsigned char *buffer, size_t length,
+                    uint64_t position)
+{
+    keyShifter->kernel(keyShifter, buffer, length, position);
+}
+
+/**
+ * @brief Adds the bytes of the buffer to the histogram.
+ * @param histogram the histogram, NUM_OF_BYTES counts indexed by the unsigned byte
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ */
+void addHistogram(uint64_t *histogram, const unsigned char *buffer, size_t length)
+{
+    uint64_t banks[HISTOGRAM_BANKS][NUM_OF_BYTES];
+    memset(banks, 0, sizeof(banks));
+    size_t i = 0;
+    for (; i + HISTOGRAM_BANKS <= length; i += HISTOGRAM_BANKS)
+    {
+        for (int bank = 0; bank < HISTOGRAM_BANKS; bank++)
+        {
+            banks[bank][buffer[i + bank]]++;
+        }
+    }
+    for (; i < length; i++)
+    {
+        banks[0][buffer[i]]++;
+    }
+    for (int bank = 0; bank < HISTOGRAM_BANKS; bank++)
+    {
+        for (int c = 0; c < NUM_OF_BYTES; c++)
+        {
+            histogram[c] += banks[bank][c];
+        }
+    }
+}
+
+/**
+ * @brief The log likelihood of a character in the letters and numbers of english text.
+ * @param c the character
+ * @return the log likelihood
+ */
+static double characterLikelihood(unsigned char c)
+{
+    if(LOW_CASE_LOW_BORDER <= c && c <= LOW_CASE_UPPER_BORDER)
+    {
+        return log(letterFrequencies[c - LOW_CASE_LOW_BORDER] / 100 * LETTERS_SHARE);
+    }
+    if(UPPER_CASE_LOW_BORDER <= c && c <= UPPER_CASE_UPPER_BORDER)
+    {
+        return log(letterFrequencies[c - UPPER_CASE_LOW_BORDER] / 100 * LETTERS_SHARE);
+    }
+    if(NUM_LOW_BORDER <= c && c <= NUM_UPPER_BORDER)
+    {
+        return log((1 - LETTERS_SHARE) / (NUM_UPPER_BORDER - NUM_LOW_BORDER + 1));
+    }
+    return log(UNLIKELY_CHARACTER);
+}
+
+/**
+ * @brief Finds the shift an input was most likely encrypted by, by how much its letters and
+ * numbers look like english once decrypted by every shift. the histogram is decrypted
+ * instead of the input, so it takes the same time for any length of input.
+ * @param histogram the histogram of the input
+ * @return the shift, 0 to MAX_SHIFT
+ */
+int detectShift(const uint64_t *histogram)
+{
+    double likelihoods[NUM_OF_BYTES];
+    for (int c = 0; c < NUM_OF_BYTES; c++)
+    {
+        likelihoods[c] = characterLikelihood((unsigned char)c);
+    }
+    int bestShift = 0;
+    double bestScore = -INFINITY;
+    for (int shift = 0; shift <= MAX_SHIFT; shift++)
+    {
+        const unsigned char *table = shiftTable(shift, 0);
+        // the rest of the bytes decrypt to themselves whatever the shift is
+        double score = 0;
+        for (int r = 0; r < NUM_OF_RANGES; r++)
+        {
+            for (int c = rangeBounds[r][0]; c <= rangeBounds[r][1]; c++)
+            {
+                score += (double)histogram[c] * likelihoods[table[c]];
+            }
+        }
+        if(score > bestScore)
+        {
+            bestScore = score;
+            bestShift = shift;
+        }
+    }
+    return bestShift;
+}
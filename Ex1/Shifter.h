@@ -0,0 +1,256 @@
+/**
+ * @file Shifter.h
+ * @author  Vitaly Frolov vitaly.frolov@mail.huji.ac.il
+ * @version 1.0
+ * @date 1 Nov 2015
+ *
+ * @brief A library that encrypts\decrypts characters and buffers by shifting them.
+ *
+ * @section DESCRIPTION
+ * Letters and numbers are shifted inside their own range, lower case letters stay lower case,
+ * upper case letters stay upper case and numbers stay numbers, everything else is kept as is.
+ * A buffer is shifted in place by a single shift or by a key, with the translation tables that
+ * are generated when the library is built or with SSE2\AVX2 kernels picked at runtime.
+ */
+#ifndef SHIFTER_H
+#define SHIFTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// -------------------------- const definitions -------------------------
+/**
+ * @def LOW_CASE_LOW_BORDER
+ * @brief A macro which is the letter 'a' in ASCII code.
+ */
+#define LOW_CASE_LOW_BORDER 97
+
+/**
+ * @def LOW_CASE_UPPER_BORDER
+ * @brief A macro which is the letter 'z' in ASCII code.
+ */
+#define LOW_CASE_UPPER_BORDER 122
+
+/**
+ * @def UPPER_CASE_LOW_BORDER
+ * @brief A macro which is the letter 'A' in ASCII code.
+ */
+#define UPPER_CASE_LOW_BORDER 65
+
+/**
+ * @def UPPER_CASE_UPPER_BORDER
+ * @brief A macro which is the letter 'Z' in ASCII code.
+ */
+#define UPPER_CASE_UPPER_BORDER 90
+
+/**
+ * @def NUM_LOW_BORDER
+ * @brief A macro which is the number '0' in ASCII code.
+ */
+#define NUM_LOW_BORDER 48
+
+/**
+ * @def NUM_UPPER_BORDER
+ * @brief A macro which is the number '9' in ASCII code.
+ */
+#define NUM_UPPER_BORDER 57
+
+/**
+ * @def NUM_OF_BYTES 256
+ * @brief A macro that sets the amount of different bytes, the size of a translation table.
+ */
+#define NUM_OF_BYTES 256
+/**
+ * @def NUM_OF_RANGES 3
+ * @brief A macro that sets the amount of characters sets that are shifted, the lower case
+ * letters, the upper case letters and the numbers.
+ */
+#define NUM_OF_RANGES 3
+/**
+ * @def MAX_SHIFT 50
+ * @brief A macro that sets the largest shift amount.
+ */
+#define MAX_SHIFT 50
+/**
+ * @def MAX_KEY_LENGTH 256
+ * @brief A macro that sets the maximal length of a key.
+ */
+#define MAX_KEY_LENGTH 256
+/**
+ * @def KEY_PATTERN_PADDING 32
+ * @brief A macro that sets how far the key pattern repeats past the end of the key, so a
+ * vector of the pattern can be loaded from any position of the key.
+ */
+#define KEY_PATTERN_PADDING 32
+
+// ------------------------------ types -----------------------------
+typedef struct Shifter Shifter;
+
+/**
+ * A pointer to a function that encrypts\decrypts a buffer in place.
+ */
+typedef void (*ShiftKernel)(const Shifter *, unsigned char *, size_t);
+
+/**
+ * @struct Shifter
+ * @brief How the characters are encrypted\decrypted, by the translation table or by the
+ * vector kernels that work out the same characters with compares and masked adds.
+ */
+struct Shifter
+{
+    ShiftKernel kernel;
+    // the encrypted\decrypted character of every byte, one of the generated tables
+    const unsigned char *table;
+    /* a character c of a range is shifted by add[r], less wrapSize[r] when c is above
+     * wrapAbove[r], if it is above belowRange[r] and below aboveRange[r]
+     */
+    signed char belowRange[NUM_OF_RANGES];
+    signed char aboveRange[NUM_OF_RANGES];
+    signed char wrapAbove[NUM_OF_RANGES];
+    signed char add[NUM_OF_RANGES];
+    signed char wrapSize[NUM_OF_RANGES];
+};
+
+typedef struct KeyShifter KeyShifter;
+
+/**
+ * A pointer to a function that encrypts\decrypts a buffer in place by a key, starting at the
+ * given position of the input.
+ */
+typedef void (*ShiftKeyKernel)(const KeyShifter *, unsigned char *, size_t, uint64_t);
+
+/**
+ * @struct KeyShifter
+ * @brief How the characters are encrypted\decrypted by a key, the character at position p of
+ * the input is shifted by the shift of the key character at p modulo the key length.
+ */
+struct KeyShifter
+{
+    ShiftKeyKernel kernel;
+    int keyLength;
+    // the translation table of the shift of every key character
+    const unsigned char *tables[MAX_KEY_LENGTH];
+    // the same as in Shifter
+    signed char belowRange[NUM_OF_RANGES];
+    signed char aboveRange[NUM_OF_RANGES];
+    signed char wrapSize[NUM_OF_RANGES];
+    /* the add and wrapAbove of Shifter for every position of the key, repeated for
+     * KEY_PATTERN_PADDING more positions
+     */
+    signed char add[NUM_OF_RANGES][MAX_KEY_LENGTH + KEY_PATTERN_PADDING];
+    signed char wrapAbove[NUM_OF_RANGES][MAX_KEY_LENGTH + KEY_PATTERN_PADDING];
+};
+
+// ------------------------------ functions -----------------------------
+/**
+ * @brief Shifts the character that was received by the desired amount.
+ * @param lowerBound The lower boundary of the characters set
+ * @param upperBound The upper boundary of the characters set
+ * @param shift The desired amount for the character to be shifted
+ * @param c The character that needs to be shifted
+ * @return The character c after it was shifted
+ */
+char charShifter(int lowerBound, int upperBound, int shift, char c);
+
+/**
+ * @brief Decrypts the character that was received by the desired amount.
+ * @param shift The desired amount for the character to be shifted
+ * @param c The character that needs to be shifted
+ * @return The character c after it was decrypted
+ */
+char decrypt(int shift, char c);
+
+/**
+ * @brief Encrypts the character that was received by the desired amount.
+ * @param shift The desired amount for the character to be shifted
+ * @param c The character that needs to be shifted
+ * @return The character c after it was encrypted
+ */
+char encrypt(int shift, char c);
+
+/**
+ * @brief Builds the translation table of the shift, the encrypted\decrypted character of
+ * every byte, so a character is encrypted\decrypted with a single lookup. the tables of the
+ * library are generated by it when the library is built.
+ * @param table the table, NUM_OF_BYTES entries indexed by the unsigned byte
+ * @param shift The desired amount for the characters to be shifted
+ * @param action 1 for encryption, 0 for decryption
+ */
+void buildShiftTable(unsigned char *table, int shift, int action);
+
+/**
+ * @brief Gets the translation table of the shift, generated when the library was built.
+ * @param shift The desired amount for the characters to be shifted, 0 to MAX_SHIFT
+ * @param action 1 for encryption, 0 for decryption
+ * @return the table, NUM_OF_BYTES entries indexed by the unsigned byte
+ */
+const unsigned char *shiftTable(int shift, int action);
+
+/**
+ * @brief Sets the shifter up for the shift and picks the fastest kernel the running cpu
+ * supports.
+ * @param shifter the shifter
+ * @param shift The desired amount for the characters to be shifted
+ * @param action 1 for encryption, 0 for decryption
+ */
+void initShifter(Shifter *shifter, int shift, int action);
+
+/**
+ * @brief Encrypts\decrypts the buffer in place.
+ * @param shifter the shifter
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ */
+void shiftBuffer(const Shifter *shifter, unsigned char *buffer, size_t length);
+
+/**
+ * @brief Encrypts\decrypts the buffer in place by the shift, with the fastest kernel the
+ * running cpu supports. the buffer isn't copied, so it may be anywhere in the memory of the
+ * caller.
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ * @param shift The desired amount for the characters to be shifted, 0 to MAX_SHIFT
+ * @param action 1 for encryption, 0 for decryption
+ * @return 1 if the buffer was shifted, 0 if the shift isn't valid
+ */
+int shift_buffer(void *buffer, size_t length, int shift, int action);
+
+/**
+ * @brief Sets the key shifter up for the key and picks the fastest kernel the running cpu
+ * supports. every letter of the key shifts by its place in the alphabet, a and A by 0, and
+ * every number by its value.
+ * @param keyShifter the key shifter
+ * @param key the key, letters and numbers only and at most MAX_KEY_LENGTH of them
+ * @param action 1 for encryption, 0 for decryption
+ * @return 1 if the key was set, 0 if it isn't a valid key
+ */
+int initKeyShifter(KeyShifter *keyShifter, const char *key, int action);
+
+/**
+ * @brief Encrypts\decrypts the buffer in place by the key.
+ * @param keyShifter the key shifter
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ * @param position the position of the buffer in the input, where in the key it starts
+ */
+void shiftKeyBuffer(const KeyShifter *keyShifter, unsigned char *buffer, size_t length,
+                    uint64_t position);
+
+/**
+ * @brief Adds the bytes of the buffer to the histogram.
+ * @param histogram the histogram, NUM_OF_BYTES counts indexed by the unsigned byte
+ * @param buffer the buffer
+ * @param length the length of the buffer
+ */
+void addHistogram(uint64_t *histogram, const unsigned char *buffer, size_t length);
+
+/**
+ * @brief Finds the shift an input was most likely encrypted by, by how much its letters and
+ * numbers look like english once decrypted by every shift. the histogram is decrypted
+ * instead of the input, so it takes the same time for any length of input.
+ * @param histogram the histogram of the input
+ * @return the shift, 0 to MAX_SHIFT
+ */
+int detectShift(const uint64_t *histogram);
+
+#endif
@@ -2,6 +2,9 @@
 #include "Board.h"
 #include "ErrorHandle.h"
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
 #include <assert.h>
 
 // -------------------------- const definitions -------------------------
@@ -23,11 +26,24 @@
  */
 #define EMPTY_SQUARE ' '
 
+
+/**
+ * @def NUM_OF_PLAYERS 2
+ * @brief A macro that sets the amount of players, each has its own bitboards
+ */
+#define NUM_OF_PLAYERS 2
+
+/**
+ * @def WORD_BITS 64
+ * @brief A macro that sets the amount of squares in a word of a bitboard
+ */
+#define WORD_BITS 64
+
 /**
- * @def ERROR 'E'
- * @brief A macro that sets the error to be E
+ * @def TILE_SIZE 16
+ * @brief A macro that sets the amount of rows and of cols of a tile of a sparse board
  */
-#define ERROR 'E'
+#define TILE_SIZE 16
 
 /**
  * @var int DEFAULT_ROW_SIZE
@@ -70,6 +86,51 @@ int const DEFAULT_PRINT = 10;
  */
 int const SIZE_MULTIPLIER = 2;
 
+/**
+ * @var int MAX_DENSE_BYTES
+ * @brief Sets the most bytes of squares and bitboards a board allocates at once, a board that
+ * would grow past them keeps only the tiles that have squares taken instead.
+ */
+int const MAX_DENSE_BYTES = 1 << 22;
+
+/**
+ * @var int DEFAULT_NUM_OF_BUCKETS
+ * @brief Sets the amount of buckets of the tiles of a board that turns sparse.
+ */
+int const DEFAULT_NUM_OF_BUCKETS = 64;
+
+/**
+ * @enum Orientation
+ * @brief The orientations of the lines of the bitboards, every square is on one line of each.
+ */
+typedef enum Orientation
+{
+    // a line per row, its bits by col
+    ROW_LINES,
+    // a line per col, its bits by row
+    COL_LINES,
+    // a line per col - row, its bits by the place along it
+    DIAGONAL_LINES,
+    // a line per row + col, its bits by the place along it
+    ANTI_DIAGONAL_LINES,
+    NUM_OF_ORIENTATIONS
+} Orientation;
+
+/**
+ * @struct defines struc in the name of Tile, TILE_SIZE x TILE_SIZE squares of a sparse board.
+ */
+typedef struct Tile
+{
+    // the coordinates of the tile, the ones of its first square divided by TILE_SIZE
+    int _tileRow;
+    int _tileCol;
+    // the next tile in the same bucket
+    struct Tile *ptrNext;
+    // the squares, row after row
+    char tileSquares[TILE_SIZE * TILE_SIZE];
+
+}Tile;
+
 /**
  * @struct defines struc in the name of Board.
  */
@@ -78,16 +139,475 @@ typedef struct Board
     // for the size of the board
     int _numOfRows;
     int _numOfCols;
+    // for the size of the allocation, the board grows inside it without moving
+    int _rowCapacity;
+    int _colCapacity;
     // the current coordinate for print board func
     int _curRow;
     int _curCol;
     int _lastTurnRow;
     int _lastTurnCol;
     char _whosTurn;
-    char **ptrBoardArr;
+    // the distance between the starts of two adjacent rows in the squares
+    int _stride;
+    // all the squares in one allocation, row after row
+    char *ptrBoardArr;
+    // a bit per square of every line of every orientation, the lines of player 1 and then
+    // the lines of player 2, in one allocation
+    uint64_t *ptrBitBoards;
+    // the buckets of the tiles of a sparse board, NULL while the board is dense. a sparse
+    // board has no squares or bitboards, only the tiles that have squares taken
+    Tile **ptrTiles;
+    int _numOfBuckets;
+    int _numOfTiles;
 
 }Board;
 
+/**
+ * @brief the index of the square at [row][col] in the squares of the board.
+ * @param board the board
+ * @param row the x coordinate
+ * @param col the y coordinate
+ * @return the index
+ */
+static size_t squareIndex(ConstBoardP board, int row, int col)
+{
+    return (size_t)row * board->_stride + col;
+}
+
+/**
+ * @brief the amount of lines of the orientation, over the capacity of the board so the lines
+ * stay as they are while the board grows inside it.
+ * @param rowCapacity the row capacity of the board
+ * @param colCapacity the col capacity of the board
+ * @param orientation the orientation
+ * @return the amount of lines
+ */
+static int numOfLines(int rowCapacity, int colCapacity, Orientation orientation)
+{
+    switch(orientation)
+    {
+        case ROW_LINES:
+            return rowCapacity;
+        case COL_LINES:
+            return colCapacity;
+        default:
+            return rowCapacity + colCapacity - 1;
+    }
+}
+
+/**
+ * @brief the amount of words of a line of the orientation. a diagonal is at most as long as
+ * the shorter side of the board, so a thin board has short diagonals.
+ * @param rowCapacity the row capacity of the board
+ * @param colCapacity the col capacity of the board
+ * @param orientation the orientation
+ * @return the amount of words
+ */
+static int wordsPerLine(int rowCapacity, int colCapacity, Orientation orientation)
+{
+    int bits;
+    switch(orientation)
+    {
+        case ROW_LINES:
+            bits = colCapacity;
+            break;
+        case COL_LINES:
+            bits = rowCapacity;
+            break;
+        default:
+            bits = rowCapacity < colCapacity ? rowCapacity : colCapacity;
+            break;
+    }
+    return (bits + WORD_BITS - 1) / WORD_BITS;
+}
+
+/**
+ * @brief the amount of words of the bitboards of one player of a board of the capacity.
+ * @param rowCapacity the row capacity of the board
+ * @param colCapacity the col capacity of the board
+ * @return the amount of words
+ */
+static size_t capacityBitBoardWords(int rowCapacity, int colCapacity)
+{
+    size_t words = 0;
+    for (int o = 0; o < NUM_OF_ORIENTATIONS; o++)
+    {
+        words += (size_t)numOfLines(rowCapacity, colCapacity, (Orientation)o) *
+                 wordsPerLine(rowCapacity, colCapacity, (Orientation)o);
+    }
+    return words;
+}
+
+/**
+ * @brief the amount of words of the bitboards of one player.
+ * @param board the board
+ * @return the amount of words
+ */
+static size_t bitBoardWords(ConstBoardP board)
+{
+    return capacityBitBoardWords(board->_rowCapacity, board->_colCapacity);
+}
+
+/**
+ * @brief the words of a line of the bitboards of a player.
+ * @param board the board
+ * @param player the index of the player
+ * @param orientation the orientation of the line
+ * @param line the index of the line
+ * @return pointer to the first word of the line
+ */
+static uint64_t *bitLine(ConstBoardP board, int player, Orientation orientation, int line)
+{
+    uint64_t *words = board->ptrBitBoards + player * bitBoardWords(board);
+    int rowCapacity = board->_rowCapacity;
+    int colCapacity = board->_colCapacity;
+    for (int o = 0; o < (int)orientation; o++)
+    {
+        words += (size_t)numOfLines(rowCapacity, colCapacity, (Orientation)o) *
+                 wordsPerLine(rowCapacity, colCapacity, (Orientation)o);
+    }
+    return words + (size_t)line * wordsPerLine(rowCapacity, colCapacity, orientation);
+}
+
+/**
+ * @brief finds the line of the orientation the square at [row][col] is on, and its bit there.
+ * @param board the board
+ * @param orientation the orientation
+ * @param row the x coordinate
+ * @param col the y coordinate
+ * @param line will hold the index of the line
+ * @param bit will hold the index of the bit of the square in the line
+ */
+static void squareLine(ConstBoardP board, Orientation orientation, int row, int col, int *line,
+                       int *bit)
+{
+    switch(orientation)
+    {
+        case ROW_LINES:
+            *line = row;
+            *bit = col;
+            break;
+        case COL_LINES:
+            *line = col;
+            *bit = row;
+            break;
+        case DIAGONAL_LINES:
+            // the place along the diagonal, from its square on the first row or col
+            *line = col - row + board->_rowCapacity - 1;
+            *bit = row < col ? row : col;
+            break;
+        default:
+            // the place along the anti diagonal, from its square on the first row or last col
+            *line = row + col;
+            *bit = row < board->_colCapacity - 1 - col ? row : board->_colCapacity - 1 - col;
+            break;
+    }
+}
+
+/**
+ * @brief the index of the bitboards of the player.
+ * @param val the char of the player
+ * @return 0 for player 1, 1 for player 2
+ */
+static int playerIndex(char val)
+{
+    return val == PLAYER1 ? 0 : 1;
+}
+
+/**
+ * @brief sets\clears the bits of the square at [row][col] in the bitboards of the player.
+ * @param board the board
+ * @param val the char of the player
+ * @param row the x coordinate
+ * @param col the y coordinate
+ * @param taken true to set the bits, false to clear them
+ */
+static void setSquareBits(BoardP board, char val, int row, int col, bool taken)
+{
+    for (int o = 0; o < NUM_OF_ORIENTATIONS; o++)
+    {
+        int line, bit;
+        squareLine(board, (Orientation)o, row, col, &line, &bit);
+        uint64_t *word = bitLine(board, playerIndex(val), (Orientation)o, line) + bit / WORD_BITS;
+        uint64_t mask = (uint64_t)1 << (bit % WORD_BITS);
+        *word = taken ? (*word | mask) : (*word & ~mask);
+    }
+}
+
+/**
+ * @brief sets the bitboards from the squares, for a board whose squares were copied.
+ * @param board the board
+ */
+static void fillBitBoards(BoardP board)
+{
+    memset(board->ptrBitBoards, 0, sizeof(uint64_t) * NUM_OF_PLAYERS * bitBoardWords(board));
+    for (int i = 0; i < board->_numOfRows; i++)
+    {
+        for (int j = 0; j < board->_numOfCols; j++)
+        {
+            char val = board->ptrBoardArr[squareIndex(board, i, j)];
+            if(val != EMPTY_SQUARE)
+            {
+                setSquareBits(board, val, i, j, true);
+            }
+        }
+    }
+}
+
+/**
+ * @brief the coordinate of the tile a row\col is in, rounded down for negative ones as well.
+ * @param coordinate the row\col
+ * @return the coordinate of the tile
+ */
+static int tileCoordinate(int coordinate)
+{
+    if(coordinate >= 0)
+    {
+        return coordinate / TILE_SIZE;
+    }
+    return -(-(coordinate + 1) / TILE_SIZE) - 1;
+}
+
+/**
+ * @brief the bucket of the tile at the tile coordinates.
+ * @param numOfBuckets the amount of buckets, a power of 2
+ * @param tileRow the x coordinate of the tile
+ * @param tileCol the y coordinate of the tile
+ * @return the index of the bucket
+ */
+static size_t tileBucket(int numOfBuckets, int tileRow, int tileCol)
+{
+    uint64_t key = ((uint64_t)(uint32_t)tileRow << 32) | (uint32_t)tileCol;
+    key *= 0x9E3779B97F4A7C15ULL;
+    return (size_t)(key >> 32) & (size_t)(numOfBuckets - 1);
+}
+
+/**
+ * @brief the square at [row][col] of the tile it is in.
+ * @param tile the tile
+ * @param row the x coordinate
+ * @param col the y coordinate
+ * @return pointer to the square
+ */
+static char *tileSquare(Tile *tile, int row, int col)
+{
+    return tile->tileSquares + (row - tile->_tileRow * TILE_SIZE) * TILE_SIZE +
+           (col - tile->_tileCol * TILE_SIZE);
+}
+
+/**
+ * @brief finds the tile of a sparse board at the tile coordinates.
+ * @param board the board
+ * @param tileRow the x coordinate of the tile
+ * @param tileCol the y coordinate of the tile
+ * @return pointer to the tile, NULL if none of its squares are taken
+ */
+static Tile *findTile(ConstBoardP board, int tileRow, int tileCol)
+{
+    Tile *tile = board->ptrTiles[tileBucket(board->_numOfBuckets, tileRow, tileCol)];
+    while(tile != NULL && (tile->_tileRow != tileRow || tile->_tileCol != tileCol))
+    {
+        tile = tile->ptrNext;
+    }
+    return tile;
+}
+
+/**
+ * @brief moves the tiles of a sparse board to a new amount of buckets.
+ * @param board the board
+ * @param numOfBuckets the new amount of buckets, a power of 2
+ * @return true\false, false if mem alloc failed and the board was left as it was
+ */
+static bool rehashTiles(BoardP board, int numOfBuckets)
+{
+    Tile **buckets = (Tile**)calloc(numOfBuckets, sizeof(Tile*));
+    if(buckets == NULL)
+    {
+        reportError(MEM_OUT);
+        return false;
+    }
+    for (int i = 0; i < board->_numOfBuckets; i++)
+    {
+        Tile *tile = board->ptrTiles[i];
+        while(tile != NULL)
+        {
+            Tile *next = tile->ptrNext;
+            size_t bucket = tileBucket(numOfBuckets, tile->_tileRow, tile->_tileCol);
+            tile->ptrNext = buckets[bucket];
+            buckets[bucket] = tile;
+            tile = next;
+        }
+    }
+    free(board->ptrTiles);
+    board->ptrTiles = buckets;
+    board->_numOfBuckets = numOfBuckets;
+    return true;
+}
+
+/**
+ * @brief adds an empty tile to a sparse board at the tile coordinates.
+ * @param board the board
+ * @param tileRow the x coordinate of the tile
+ * @param tileCol the y coordinate of the tile
+ * @return pointer to the tile, NULL if mem alloc failed
+ */
+static Tile *addTile(BoardP board, int tileRow, int tileCol)
+{
+    // the buckets are multiplied as the tiles are added, so they stay about one per bucket
+    if(board->_numOfTiles >= board->_numOfBuckets &&
+       !rehashTiles(board, board->_numOfBuckets * SIZE_MULTIPLIER))
+    {
+        return NULL;
+    }
+    Tile *tile = (Tile*)malloc(sizeof(Tile));
+    if(tile == NULL)
+    {
+        reportError(MEM_OUT);
+        return NULL;
+    }
+    tile->_tileRow = tileRow;
+    tile->_tileCol = tileCol;
+    memset(tile->tileSquares, EMPTY_SQUARE, sizeof(tile->tileSquares));
+    size_t bucket = tileBucket(board->_numOfBuckets, tileRow, tileCol);
+    tile->ptrNext = board->ptrTiles[bucket];
+    board->ptrTiles[bucket] = tile;
+    board->_numOfTiles++;
+    return tile;
+}
+
+/**
+ * @brief removes the tile from a sparse board, once none of its squares are taken.
+ * @param board the board
+ * @param tile the tile
+ */
+static void removeTile(BoardP board, Tile *tile)
+{
+    Tile **link = &board->ptrTiles[tileBucket(board->_numOfBuckets, tile->_tileRow,
+                                              tile->_tileCol)];
+    while(*link != tile)
+    {
+        link = &(*link)->ptrNext;
+    }
+    *link = tile->ptrNext;
+    free(tile);
+    board->_numOfTiles--;
+}
+
+/**
+ * @brief frees the tiles and the buckets of a sparse board, which then has none.
+ * @param board the board
+ */
+static void freeTiles(BoardP board)
+{
+    for (int i = 0; i < board->_numOfBuckets; i++)
+    {
+        while(board->ptrTiles[i] != NULL)
+        {
+            Tile *next = board->ptrTiles[i]->ptrNext;
+            free(board->ptrTiles[i]);
+            board->ptrTiles[i] = next;
+        }
+    }
+    free(board->ptrTiles);
+    board->ptrTiles = NULL;
+    board->_numOfBuckets = 0;
+    board->_numOfTiles = 0;
+}
+
+/**
+ * @brief finds the square at [row][col], of the squares of a dense board or of the tiles of a
+ * sparse one.
+ * @param board the board
+ * @param row the x coordinate
+ * @param col the y coordinate
+ * @return pointer to the square, NULL if it is outside the board or in a tile it doesn't have,
+ *         which means the square is empty
+ */
+static char *findSquare(ConstBoardP board, int row, int col)
+{
+    if(board->ptrTiles == NULL)
+    {
+        if(row < 0 || col < 0 || row >= board->_numOfRows || col >= board->_numOfCols)
+        {
+            return NULL;
+        }
+        return board->ptrBoardArr + squareIndex(board, row, col);
+    }
+    int tileRow = tileCoordinate(row);
+    int tileCol = tileCoordinate(col);
+    Tile *tile = findTile(board, tileRow, tileCol);
+    if(tile == NULL)
+    {
+        return NULL;
+    }
+    return tileSquare(tile, row, col);
+}
+
+/**
+ * @brief finds the square at [row][col] of a sparse board, and adds its tile if it has none.
+ * @param board the board
+ * @param row the x coordinate
+ * @param col the y coordinate
+ * @return pointer to the square, NULL if mem alloc failed
+ */
+static char *addSquare(BoardP board, int row, int col)
+{
+    int tileRow = tileCoordinate(row);
+    int tileCol = tileCoordinate(col);
+    Tile *tile = findTile(board, tileRow, tileCol);
+    if(tile == NULL)
+    {
+        tile = addTile(board, tileRow, tileCol);
+        if(tile == NULL)
+        {
+            return NULL;
+        }
+    }
+    return tileSquare(tile, row, col);
+}
+
+/**
+ * @brief turns a dense board into a sparse one, the taken squares are moved into tiles and
+ * the squares and the bitboards are freed.
+ * @param board the board
+ * @return true\false, false if mem alloc failed and the board was left dense
+ */
+static bool makeSparse(BoardP board)
+{
+    board->ptrTiles = (Tile**)calloc(DEFAULT_NUM_OF_BUCKETS, sizeof(Tile*));
+    if(board->ptrTiles == NULL)
+    {
+        reportError(MEM_OUT);
+        return false;
+    }
+    board->_numOfBuckets = DEFAULT_NUM_OF_BUCKETS;
+    board->_numOfTiles = 0;
+    for (int i = 0; i < board->_numOfRows; i++)
+    {
+        for (int j = 0; j < board->_numOfCols; j++)
+        {
+            char val = board->ptrBoardArr[squareIndex(board, i, j)];
+            if(val == EMPTY_SQUARE)
+            {
+                continue;
+            }
+            char *square = addSquare(board, i, j);
+            if(square == NULL)
+            {
+                freeTiles(board);
+                return false;
+            }
+            *square = val;
+        }
+    }
+    free(board->ptrBoardArr);
+    free(board->ptrBitBoards);
+    board->ptrBoardArr = NULL;
+    board->ptrBitBoards = NULL;
+    return true;
+}
+
 /**
  * @brief creates new playing board.
  * @param rows the amount of rows in the board
@@ -104,36 +624,33 @@ BoardP createNewBoard(int rows, int cols)
     }
     p->_curRow = DEFAULT_ROW_STARTING_COORDINATE;
     p->_curCol = DEFAULT_COL_STARTING_COORDINATE;
+    p->_lastTurnRow = 0;
+    p->_lastTurnCol = 0;
     p->_numOfRows = rows;
     p->_numOfCols = cols;
+    p->_rowCapacity = rows;
+    p->_colCapacity = cols;
+    p->_stride = cols;
     p->_whosTurn = PLAYER1;
-    char** arrayPointer = (char**)malloc(sizeof(char*) * p->_numOfRows);
-    if(arrayPointer == NULL)
+    p->ptrTiles = NULL;
+    p->_numOfBuckets = 0;
+    p->_numOfTiles = 0;
+    p->ptrBitBoards = NULL;
+    p->ptrBoardArr = (char*)malloc(sizeof(char) * (size_t)rows * cols);
+    if(p->ptrBoardArr == NULL)
     {
-        p->_numOfRows = 0;
         freeBoard(p);
         reportError(MEM_OUT);
         return NULL;
     }
-    for (int i = 0; i < p->_numOfRows; i++)
+    p->ptrBitBoards = (uint64_t*)calloc(NUM_OF_PLAYERS * bitBoardWords(p), sizeof(uint64_t));
+    if(p->ptrBitBoards == NULL)
     {
-        arrayPointer[i] = (char*)malloc(sizeof(char) * p->_numOfCols);
-        if(arrayPointer[i] == NULL)
-        {
-            p->_numOfRows = i;
-            freeBoard(p);
-            reportError(MEM_OUT);
-            return NULL;
-        }
-    }
-    p->ptrBoardArr = arrayPointer;
-    for (int i = 0; i < p->_numOfRows; i++)
-    {
-        for (int j = 0; j < p->_numOfCols; j++)
-        {
-            p->ptrBoardArr[i][j] = EMPTY_SQUARE;
-        }
+        freeBoard(p);
+        reportError(MEM_OUT);
+        return NULL;
     }
+    memset(p->ptrBoardArr, EMPTY_SQUARE, sizeof(char) * (size_t)rows * cols);
     return p;
 }
 
@@ -146,6 +663,54 @@ BoardP createNewDefaultBoard()
     return createNewBoard(DEFAULT_ROW_SIZE, DEFAULT_COL_SIZE);
 }
 
+/**
+ * @brief copies whose turn it is, the last turn and the print location of a board.
+ * @param board the board they are copied to
+ * @param originalBoard the board they are copied from
+ */
+static void copyTurns(BoardP board, ConstBoardP originalBoard)
+{
+    board->_curCol = originalBoard->_curCol;
+    board->_curRow = originalBoard->_curRow;
+    board->_lastTurnCol = originalBoard->_lastTurnCol;
+    board->_lastTurnRow = originalBoard->_lastTurnRow;
+    board->_whosTurn = originalBoard->_whosTurn;
+}
+
+/**
+ * @brief creates exact copy of the given sparse board, tile by tile.
+ * @param originalBoard the board that is copied
+ * @return pointer to a Board struct
+ */
+static BoardP duplicateSparseBoard(ConstBoardP originalBoard)
+{
+    BoardP p = createNewDefaultBoard();
+    if(p == NULL)
+    {
+        return NULL;
+    }
+    if(!makeSparse(p) || !rehashTiles(p, originalBoard->_numOfBuckets))
+    {
+        freeBoard(p);
+        return NULL;
+    }
+    copyTurns(p, originalBoard);
+    for (int i = 0; i < originalBoard->_numOfBuckets; i++)
+    {
+        for (Tile *tile = originalBoard->ptrTiles[i]; tile != NULL; tile = tile->ptrNext)
+        {
+            Tile *copy = addTile(p, tile->_tileRow, tile->_tileCol);
+            if(copy == NULL)
+            {
+                freeBoard(p);
+                return NULL;
+            }
+            memcpy(copy->tileSquares, tile->tileSquares, sizeof(tile->tileSquares));
+        }
+    }
+    return p;
+}
+
 /**
  * @brief creates exact copy of the given board.
  * @param originalBoard the board that is copied
@@ -154,19 +719,23 @@ BoardP createNewDefaultBoard()
 BoardP duplicateBoard(ConstBoardP originalBoard)
 {
     assert(originalBoard != NULL);
-    BoardP p = createNewBoard(originalBoard->_numOfRows, originalBoard->_numOfCols);
-    p->_curCol = originalBoard->_curCol;
-    p->_curRow = originalBoard->_curRow;
-    p->_lastTurnCol = originalBoard->_lastTurnCol;
-    p->_lastTurnRow = originalBoard->_lastTurnRow;
-    p->_whosTurn = originalBoard->_whosTurn;
-    for (int i = 0; i < originalBoard->_numOfRows; i++)
-    {
-        for (int j = 0; j < originalBoard->_numOfCols; j++)
-        {
-            p->ptrBoardArr[i][j] = originalBoard->ptrBoardArr[i][j];
-        }
+    if(originalBoard->ptrTiles != NULL)
+    {
+        return duplicateSparseBoard(originalBoard);
     }
+    BoardP p = createNewBoard(originalBoard->_rowCapacity, originalBoard->_colCapacity);
+    if(p == NULL)
+    {
+        return NULL;
+    }
+    p->_numOfRows = originalBoard->_numOfRows;
+    p->_numOfCols = originalBoard->_numOfCols;
+    copyTurns(p, originalBoard);
+    // both boards have the same stride, so the squares are copied at once
+    memcpy(p->ptrBoardArr, originalBoard->ptrBoardArr,
+           sizeof(char) * (size_t)originalBoard->_rowCapacity * originalBoard->_stride);
+    memcpy(p->ptrBitBoards, originalBoard->ptrBitBoards,
+           sizeof(uint64_t) * NUM_OF_PLAYERS * bitBoardWords(originalBoard));
     return p;
 }
 
@@ -190,39 +759,73 @@ static int chooseSize(int oldSizeBound, int coordinate)
 }
 
 /**
- * @brief creates a copy of the board and increases its boundaries.
- * @param originalBoard the board that will be copied
- * @param rows the amount of rows in the board
- * @param cols the amount of cols in the board
- * @return pointer to a Board struct
+ * @brief func that decides the new capacity of the board.
+ * @param capacity the board's original row\col capacity
+ * @param size the row\col size the board grows to
+ * @return the original capacity if the size fits in it, otherwise the larger of the size and
+ *         the capacity multiplied, so a board that keeps growing is copied only now and then
  */
-static BoardP resizeBoard(BoardP originalBoard, int row, int col)
+static int chooseCapacity(int capacity, int size)
 {
-    assert(originalBoard != NULL);
-    int newRow = chooseSize(originalBoard->_numOfRows, row);
-    int newCol = chooseSize(originalBoard->_numOfCols, col);
-    BoardP enlargedBoard = createNewBoard(newRow, newCol);
-    if(enlargedBoard != NULL)
-    {
-        enlargedBoard->_curCol = originalBoard->_curCol;
-        enlargedBoard->_curRow = originalBoard->_curRow;
-        enlargedBoard->_lastTurnCol = originalBoard->_lastTurnCol;
-        enlargedBoard->_lastTurnRow = originalBoard->_lastTurnRow;
-        enlargedBoard->_whosTurn = originalBoard->_whosTurn;
-        for (int i = 0; i < originalBoard->_numOfRows; i++)
-        {
-            for (int j = 0; j < originalBoard->_numOfCols; j++)
-            {
-                enlargedBoard->ptrBoardArr[i][j] = originalBoard->ptrBoardArr[i][j];
-            }
-        }
-        return enlargedBoard;
+    if(size <= capacity)
+    {
+        return capacity;
     }
-    else
+    if(capacity * SIZE_MULTIPLIER > size)
     {
-        return NULL;
+        return capacity * SIZE_MULTIPLIER;
     }
+    return size;
+}
 
+/**
+ * @brief increases the boundaries of the board in place, the board keeps its address.
+ * the squares are copied once, into a larger allocation, only when the boundaries outgrow its
+ * capacity.
+ * @param board the board
+ * @param row the x coordinate that has to fit in the board
+ * @param col the y coordinate that has to fit in the board
+ * @return true\false, false if mem alloc failed and the board was left as it was
+ */
+static bool resizeBoard(BoardP board, int row, int col)
+{
+    assert(board != NULL);
+    int newRow = chooseSize(board->_numOfRows, row);
+    int newCol = chooseSize(board->_numOfCols, col);
+    int rowCapacity = chooseCapacity(board->_rowCapacity, newRow);
+    int colCapacity = chooseCapacity(board->_colCapacity, newCol);
+    if(rowCapacity != board->_rowCapacity || colCapacity != board->_colCapacity)
+    {
+        BoardP enlargedBoard = createNewBoard(rowCapacity, colCapacity);
+        if(enlargedBoard == NULL)
+        {
+            return false;
+        }
+        for (int i = 0; i < board->_numOfRows; i++)
+        {
+            memcpy(enlargedBoard->ptrBoardArr + squareIndex(enlargedBoard, i, 0),
+                   board->ptrBoardArr + squareIndex(board, i, 0),
+                   sizeof(char) * board->_numOfCols);
+        }
+        // the board takes the enlarged allocations, and the old ones are freed with the
+        // enlarged board
+        char *squares = board->ptrBoardArr;
+        uint64_t *bitBoards = board->ptrBitBoards;
+        board->ptrBoardArr = enlargedBoard->ptrBoardArr;
+        board->ptrBitBoards = enlargedBoard->ptrBitBoards;
+        enlargedBoard->ptrBoardArr = squares;
+        enlargedBoard->ptrBitBoards = bitBoards;
+        freeBoard(enlargedBoard);
+        board->_rowCapacity = rowCapacity;
+        board->_colCapacity = colCapacity;
+        board->_stride = colCapacity;
+        // the lines change with the capacity of the board
+        fillBitBoards(board);
+    }
+    // the squares past the old boundaries are empty already
+    board->_numOfRows = newRow;
+    board->_numOfCols = newCol;
+    return true;
 }
 
 
@@ -270,6 +873,71 @@ static bool isYourTurn(BoardP board, char val)
     return false;
 }
 
+/**
+ * @brief checks if the board can stay dense with [row][col] in it.
+ * @param board the dense board
+ * @param row the x coordinate
+ * @param col the y coordinate
+ * @return true\false, false for a negative coordinate or if the squares and the bitboards of
+ *         the board would outgrow MAX_DENSE_BYTES
+ */
+static bool fitsDenseBoard(ConstBoardP board, int row, int col)
+{
+    if(isBadRowCol(row) || isBadRowCol(col))
+    {
+        return false;
+    }
+    // at most the capacity resizeBoard would choose
+    long long rows = board->_rowCapacity;
+    long long cols = board->_colCapacity;
+    if(row >= board->_numOfRows)
+    {
+        rows = (long long)(row > rows ? row : rows) * SIZE_MULTIPLIER;
+    }
+    if(col >= board->_numOfCols)
+    {
+        cols = (long long)(col > cols ? col : cols) * SIZE_MULTIPLIER;
+    }
+    // each one is checked alone first, so their product can't overflow
+    if(rows > MAX_DENSE_BYTES || cols > MAX_DENSE_BYTES)
+    {
+        return false;
+    }
+    long long bytes = rows * cols * (long long)sizeof(char);
+    bytes += NUM_OF_PLAYERS * (long long)capacityBitBoardWords((int)rows, (int)cols) *
+             (long long)sizeof(uint64_t);
+    return bytes <= MAX_DENSE_BYTES;
+}
+
+/**
+ * @brief finds the square at [row][col] to put a char in. a dense board grows to have it, or
+ * turns sparse if it can't, and a sparse board adds its tile.
+ * @param board the board
+ * @param row the x coordinate
+ * @param col the y coordinate
+ * @return pointer to the square, NULL if mem alloc failed
+ */
+static char *reserveSquare(BoardP board, int row, int col)
+{
+    if(board->ptrTiles == NULL)
+    {
+        if(fitsDenseBoard(board, row, col))
+        {
+            if((row >= board->_numOfRows || col >= board->_numOfCols) &&
+               !resizeBoard(board, row, col))
+            {
+                return NULL;
+            }
+            return board->ptrBoardArr + squareIndex(board, row, col);
+        }
+        if(!makeSparse(board))
+        {
+            return NULL;
+        }
+    }
+    return addSquare(board, row, col);
+}
+
 /**
  * @brief returns the char located at [row][col].
  * @param theBoard the board
@@ -280,16 +948,12 @@ static bool isYourTurn(BoardP board, char val)
 char getBoardSquare(ConstBoardP theBoard, int row, int col)
 {
     assert(theBoard != NULL);
-    if(isBadRowCol(row) || isBadRowCol(col))
-    {
-        reportError(OUT_OF_BOUND);
-        return ERROR;
-    }
-    if( row > theBoard->_numOfRows || col > theBoard->_numOfCols)
+    const char *square = findSquare(theBoard, row, col);
+    if(square == NULL)
     {
         return EMPTY_SQUARE;
     }
-    switch(theBoard->ptrBoardArr[row][col])
+    switch(*square)
     {
         case (PLAYER1):
             return PLAYER1;
@@ -301,7 +965,7 @@ char getBoardSquare(ConstBoardP theBoard, int row, int col)
 }
 
 /**
- * @brief tries to put the given char at [row][col].
+ * @brief tries to put the given char at [row][col], and marks it as the last turn.
  * @param theBoard the board
  * @param row the x coordinate
  * @param col the y coordinate
@@ -316,43 +980,34 @@ bool putBoardSquare(BoardP theBoard, int row, int col, char val)
         reportError(BAD_VAL);
         return false;
     }
-    if(isBadRowCol(row) || isBadRowCol(col))
-    {
-        reportError(OUT_OF_BOUND);
-        return false;
-    }
     if(!isYourTurn(theBoard, val))
     {
         reportError(WRONG_TURN);
         return false;
     }
-    if(row > theBoard->_numOfRows - 1 || col > theBoard->_numOfCols - 1)
+    char *square = reserveSquare(theBoard, row, col);
+    if(square == NULL)
     {
-        BoardP temp = resizeBoard(theBoard, row, col);
-        if(temp != NULL)
-        {
-            freeBoard(theBoard);
-            theBoard = duplicateBoard(temp);
-            freeBoard(temp);
-
-            return true;
-        }
-        else
-        {
-            // mem alloc failed
-            return false;
-        }
+        // mem alloc failed
+        return false;
     }
-    if(theBoard->ptrBoardArr[row][col] != EMPTY_SQUARE)
+    if(*square != EMPTY_SQUARE)
     {
         reportError(SQUARE_FULL);
         return false;
     }
+    *square = val;
+    if(theBoard->ptrTiles == NULL)
+    {
+        setSquareBits(theBoard, val, row, col, true);
+    }
+    theBoard->_lastTurnRow = row;
+    theBoard->_lastTurnCol = col;
     return true;
 }
 
 /**
- * @brief tries to remove char located at [row][col].
+ * @brief tries to remove char located at [row][col], and empties the square.
  * @param theBoard the board
  * @param row the x coordinate
  * @param col the y coordinate
@@ -361,104 +1016,148 @@ bool putBoardSquare(BoardP theBoard, int row, int col, char val)
 bool cancelMove(BoardP theBoard, int x, int y)
 {
     assert(theBoard != NULL);
-    if(isBadRowCol(x) || isBadRowCol(y))
+    char *square = findSquare(theBoard, x, y);
+    if(square == NULL)
     {
-        reportError(OUT_OF_BOUND);
         return false;
     }
-    if(theBoard->ptrBoardArr[x][y] == EMPTY_SQUARE ||
-       theBoard->ptrBoardArr[x][y] == theBoard->_whosTurn)
+    if(*square == EMPTY_SQUARE || *square == theBoard->_whosTurn)
     {
         reportError(ILLEGAL_CANCELLATION);
         return false;
     }
-    if(x > theBoard->_numOfRows || y > theBoard->_numOfCols)
+    if(theBoard->ptrTiles == NULL)
     {
-        return false;
+        setSquareBits(theBoard, *square, x, y, false);
+        *square = EMPTY_SQUARE;
+        return true;
+    }
+    *square = EMPTY_SQUARE;
+    // the memory of a sparse board follows its taken squares
+    Tile *tile = findTile(theBoard, tileCoordinate(x), tileCoordinate(y));
+    if(memchr(tile->tileSquares, PLAYER1, sizeof(tile->tileSquares)) == NULL &&
+       memchr(tile->tileSquares, PLAYER2, sizeof(tile->tileSquares)) == NULL)
+    {
+        removeTile(theBoard, tile);
     }
     return true;
 }
 
 /**
- * @brief function that tries to find sequence that will allow a player to win.
- * @param theBoard the board
- * @param startingXIndex the x coordinate that the search will begin from
- * @param endXIndex the x coordinate that the search will end at
- * @param startingYIndex the y coordinate that the search will begin from
- * @param endYIndex the y coordinate that the search will end at
- * @param val the char of the sequence
+ * @brief checks if squares of a line have AMOUNT_TO_WIN in a row through one of them.
+ * @param squares a bit per square of the line
+ * @param bit the bit of the square the sequence has to pass by
  * @return true\false
  */
-static bool checkSequence(ConstBoardP board, int startingXIndex, int endXIndex,
-                          int startingYIndex, int endYIndex, char val)
+static bool isSequence(uint64_t squares, int bit)
 {
-    int count = 0;
-    int x = startingXIndex;
-    int y = startingYIndex;
-    while(x < endXIndex || y < endYIndex)
+    // only a sequence that ends up to AMOUNT_TO_WIN - 1 squares after the bit passes by it
+    int amount = bit + AMOUNT_TO_WIN;
+    if(amount < WORD_BITS)
     {
-        if(board->ptrBoardArr[x][y] == val)
-        {
-            count ++;
-        }
-        else
-        {
-            count = 0;
-        }
-        if(count == AMOUNT_TO_WIN)
-        {
-            return true;
-        }
-        if(x != endXIndex)
-        {
-            x++;
-        }
-        if(y != endYIndex)
-        {
-            y++;
-        }
-
+        squares &= ((uint64_t)1 << amount) - 1;
     }
-    return false;
+    uint64_t sequences = squares;
+    for (int i = 1; i < AMOUNT_TO_WIN; i++)
+    {
+        sequences &= squares >> i;
+    }
+    return sequences != 0;
 }
 
 /**
- * @brief tries to find a winner.
- * @param theBoard the board
+ * @brief function that tries to find sequence through the square at [row][col] that will allow
+ * a player to win, on the line of the orientation.
+ * the squares around it are taken from the bitboard at once and are all checked with shifts.
+ * @param board the board
+ * @param player the index of the player
+ * @param orientation the orientation of the line
+ * @param row the x coordinate
+ * @param col the y coordinate
  * @return true\false
  */
-char getWinner(ConstBoardP board)
+static bool checkSequence(ConstBoardP board, int player, Orientation orientation, int row,
+                          int col)
 {
-    assert(board != NULL);
-    int x = board->_lastTurnRow;
-    int y = board->_lastTurnCol;
-    int minXCoordinate = x - AMOUNT_TO_WIN;
-    int maxXCoordinate = x + AMOUNT_TO_WIN;
-    int minYCoordinate = y - AMOUNT_TO_WIN;
-    int maxYCoordinate = y + AMOUNT_TO_WIN;
-    if(minXCoordinate < 0)
+    int line, bit;
+    squareLine(board, orientation, row, col, &line, &bit);
+    const uint64_t *words = bitLine(board, player, orientation, line);
+    int first = bit - (AMOUNT_TO_WIN - 1);
+    if(first < 0)
     {
-        minXCoordinate = 0;
+        first = 0;
     }
-    if(minYCoordinate < 0)
+    // the squares from first on, the words past the line's last one are never read
+    int word = first / WORD_BITS;
+    int offset = first % WORD_BITS;
+    uint64_t squares = words[word] >> offset;
+    if(offset != 0 &&
+       word + 1 < wordsPerLine(board->_rowCapacity, board->_colCapacity, orientation))
     {
-        minYCoordinate = 0;
+        squares |= words[word + 1] << (WORD_BITS - offset);
     }
-    if(maxXCoordinate  > board->_numOfRows)
-    {
-        maxXCoordinate = board->_numOfRows - 1;
-    }
-    if(maxYCoordinate  > board->_numOfCols)
+    return isSequence(squares, bit - first);
+}
+
+/**
+ * @brief function that tries to find sequence through the square at [row][col] of a sparse
+ * board that will allow a player to win, on the line of the orientation.
+ * the squares around it are gathered into a word and are all checked with shifts.
+ * @param board the board
+ * @param val the char of the player
+ * @param orientation the orientation of the line
+ * @param row the x coordinate
+ * @param col the y coordinate
+ * @return true\false
+ */
+static bool checkSparseSequence(ConstBoardP board, char val, Orientation orientation, int row,
+                                int col)
+{
+    // the steps of the rows and the cols from a square of the line to the next one
+    static const int steps[NUM_OF_ORIENTATIONS][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+    uint64_t squares = 0;
+    for (int i = 0; i < 2 * AMOUNT_TO_WIN - 1; i++)
     {
-        minYCoordinate = board->_numOfCols - 1;
+        long long x = row + (long long)(i - (AMOUNT_TO_WIN - 1)) * steps[orientation][0];
+        long long y = col + (long long)(i - (AMOUNT_TO_WIN - 1)) * steps[orientation][1];
+        if(x < INT_MIN || x > INT_MAX || y < INT_MIN || y > INT_MAX)
+        {
+            continue;
+        }
+        const char *square = findSquare(board, (int)x, (int)y);
+        if(square != NULL && *square == val)
+        {
+            squares |= (uint64_t)1 << i;
+        }
     }
-    if(checkSequence(board, minXCoordinate, maxXCoordinate, y, y, board->_whosTurn) ||
-       checkSequence(board, x, x, minYCoordinate, maxYCoordinate, board->_whosTurn) ||
-       checkSequence(board, minXCoordinate, maxXCoordinate,
-       minYCoordinate, maxYCoordinate, board->_whosTurn))
-    {
+    return isSequence(squares, AMOUNT_TO_WIN - 1);
+}
 
-        return board->_whosTurn;
+/**
+ * @brief tries to find a winner, in a sequence through the last turn.
+ * @param theBoard the board
+ * @return the char of the winner, ' ' if there is none
+ */
+char getWinner(ConstBoardP board)
+{
+    assert(board != NULL);
+    for (int o = 0; o < NUM_OF_ORIENTATIONS; o++)
+    {
+        bool isWin;
+        if(board->ptrTiles == NULL)
+        {
+            isWin = checkSequence(board, playerIndex(board->_whosTurn), (Orientation)o,
+                                  board->_lastTurnRow, board->_lastTurnCol);
+        }
+        else
+        {
+            isWin = checkSparseSequence(board, board->_whosTurn, (Orientation)o,
+                                        board->_lastTurnRow, board->_lastTurnCol);
+        }
+        if(isWin)
+        {
+            return board->_whosTurn;
+        }
     }
     return EMPTY_SQUARE;
 }
@@ -471,17 +1170,9 @@ void freeBoard(BoardP board)
 {
     if(board != NULL)
     {
-        for (int i = 0; i < board->_numOfRows; i++)
-        {
-            if(board->ptrBoardArr[i] != NULL)
-            {
-                free(board->ptrBoardArr[i]);
-            }
-        }
-        if(board->ptrBoardArr != NULL)
-        {
-            free(board->ptrBoardArr);
-        }
+        freeTiles(board);
+        free(board->ptrBitBoards);
+        free(board->ptrBoardArr);
         free(board);
     }
 
@@ -499,11 +1190,6 @@ void printBoard(FILE * stream, ConstBoardP board, int row, int col)
 {
     assert(board != NULL);
     assert(stream != NULL);
-    if(isBadRowCol(row) || isBadRowCol(col))
-    {
-        reportError(OUT_OF_BOUND);
-        return;
-    }
     fprintf(stream, "   ");
     for (int i = 0; i < DEFAULT_PRINT; i++)
     {
@@ -515,9 +1201,15 @@ void printBoard(FILE * stream, ConstBoardP board, int row, int col)
         fprintf(stream, "+%d ", i - row);
         for (int j = col; j < col + DEFAULT_PRINT; j++)
         {
-            if(i < board->_numOfRows && j < board->_numOfCols)
+            // a sparse board has no boundaries, all of its squares are printed
+            const char *square = findSquare(board, i, j);
+            if(square != NULL)
             {
-                fprintf(stream, " %c ", board->ptrBoardArr[i][j]);
+                fprintf(stream, " %c ", *square);
+            }
+            else if(board->ptrTiles != NULL)
+            {
+                fprintf(stream, " %c ", EMPTY_SQUARE);
             }
         }
         fprintf(stream, "\n");
@@ -535,19 +1227,28 @@ int getAllocatedSize(ConstBoardP board)
     int size = 0;
     size += sizeof(board->_numOfCols);
     size += sizeof(board->_numOfRows);
+    size += sizeof(board->_rowCapacity);
+    size += sizeof(board->_colCapacity);
     size += sizeof(board->_curRow);
     size += sizeof(board->_curCol);
     size += sizeof(board->_lastTurnRow);
     size += sizeof(board->_lastTurnCol);
     size += sizeof(board->_whosTurn);
+    size += sizeof(board->_stride);
     size += sizeof(board->ptrBoardArr);
-    for (int i = 0; i < board->_numOfRows; i++)
+    size += sizeof(board->ptrBitBoards);
+    size += sizeof(board->ptrTiles);
+    size += sizeof(board->_numOfBuckets);
+    size += sizeof(board->_numOfTiles);
+    if(board->ptrTiles == NULL)
     {
-        for (int j = 0; j < board->_numOfCols; j++)
-        {
-            size += sizeof(board->ptrBoardArr[i][j]);
-        }
-        size += sizeof(board->ptrBoardArr[i]);
+        size += board->_rowCapacity * board->_stride * sizeof(board->ptrBoardArr[0]);
+        size += NUM_OF_PLAYERS * bitBoardWords(board) * sizeof(board->ptrBitBoards[0]);
+    }
+    else
+    {
+        size += board->_numOfBuckets * sizeof(board->ptrTiles[0]);
+        size += board->_numOfTiles * sizeof(Tile);
     }
     size += sizeof(board);
     return size;
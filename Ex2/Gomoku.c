@@ -1,7 +1,7 @@
 // ------------------------------ includes ------------------------------
 #include <stdio.h>
 #include <stdlib.h>
-#include <assert.h>
+#include <stdint.h>
 #include "Board.h"
 
 // -------------------------- const definitions -------------------------
@@ -71,13 +71,20 @@ typedef struct Board
     // for the size of the board
     int _numOfRows;
     int _numOfCols;
+    int _rowCapacity;
+    int _colCapacity;
     // the current coordinate for print board func
     int _curRow;
     int _curCol;
     int _lastTurnRow;
     int _lastTurnCol;
     char _whosTurn;
-    char **ptrBoardArr;
+    int _stride;
+    char *ptrBoardArr;
+    uint64_t *ptrBitBoards;
+    struct Tile **ptrTiles;
+    int _numOfBuckets;
+    int _numOfTiles;
 
 }Board;
 
@@ -126,14 +133,8 @@ void makeMove(BoardP boardP, int lineNum, FILE *inputStream)
 {
     int x, y;
     coordinateCheck(&x, &y, inputStream, lineNum, boardP);
-    if(putBoardSquare(boardP, x, y, boardP->_whosTurn))
-    {
-        //after a successful turn, there is need to swtich players, and to update
-        //the last used x,y coordinates
-        boardP->ptrBoardArr[x][y] = boardP->_whosTurn;
-        boardP->_lastTurnRow = x;
-        boardP->_lastTurnCol = y;
-    }
+    //a successful turn puts the char and updates the last used x,y coordinates
+    putBoardSquare(boardP, x, y, boardP->_whosTurn);
 
 }
 
@@ -147,11 +148,8 @@ void delMove(BoardP boardP, int lineNum, FILE *inputStream)
 {
     int x, y;
     coordinateCheck(&x, &y, inputStream, lineNum, boardP);
-    if(cancelMove(boardP, x, y))
-    {
-        //if its possible to remove the char then its changed to an empty space
-        boardP->ptrBoardArr[x][y] = EMPTY_SQUARE;
-    }
+    //if its possible to remove the char then its changed to an empty space
+    cancelMove(boardP, x, y);
 
 }
 
@@ -165,8 +163,7 @@ void changePrintLoc(BoardP board, int lineNum, FILE *inputStream)
 {
     int x, y;
     coordinateCheck(&x, &y, inputStream, lineNum, board);
-    //the x,y coordinates are positive numbers
-    assert(x >= 0 && y >= 0);
+    //the x,y coordinates may be negative, the board has no boundaries
     board->_curRow = x;
     board->_curCol = y;
 }